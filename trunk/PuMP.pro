@@ -1,5 +1,5 @@
 # Platform independent project-file for "Publish My Pictures"
-# note: You need qt4-qmake version 4.2 or higher to build this project-file!
+# note: You need qt4-qmake version 4.3 or higher to build this project-file!
 
 # output directory
 DESTDIR = ./
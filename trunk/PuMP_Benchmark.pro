@@ -0,0 +1,28 @@
+# Benchmark of the overview's thumbnail-pipeline of "Publish My Pictures"
+# note: You need qt4-qmake version 4.3 or higher to build this project-file!
+# usage: PuMP_Benchmark [--dir PATH] [--count N] [--size WxH] [--threads N]
+#	[--rows N] [--orientation N]
+
+# output directory, the objects are kept apart from the application's
+DESTDIR = ./
+TARGET = PuMP_Benchmark
+OBJECTS_DIR = bench/obj
+MOC_DIR = bench/moc
+RCC_DIR = bench/rcc
+
+include(res/qmake.in)
+include(src/qmake.in)
+include(src/zip/qmake.in)
+include(src/zlib/qmake.in)
+include(bench/qmake.in)
+
+# the benchmark brings its own main-function
+SOURCES -= src/main.cpp
+
+# built application not lib
+TEMPLATE = app
+
+# use qt-lib
+CONFIG += qt release console
+
+win32{ DEFINES += WINDOWS }
@@ -0,0 +1,895 @@
+/*
+ * Copyright 2007 Christoph Werle, Tobias Schlager
+ * 
+ * This file is part of "PuMP - Publish My Pictures".
+ *
+ * "Publish My Pictures" is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * "Publish My Pictures" is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with "Publish My Pictures"; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ */
+
+#include <limits.h>
+#include <stdio.h>
+
+#ifndef WINDOWS
+#include <sys/resource.h>
+#endif
+
+#include <QApplication>
+#include <QFile>
+#include <QImageReader>
+#include <QMatrix>
+#include <QSettings>
+
+#include "bench/benchmark.hh"
+#include "src/downsampler.hh"
+#include "src/mainWindow.hh"
+#include "src/orientation.hh"
+#include "src/thumbnailCache.hh"
+
+/*****************************************************************************/
+
+/**
+ * Function that downsamples an image decoded as a whole, as reference for
+ * PuMP_Downsampler: the colors of all source-pixels falling into a
+ * target-pixel are averaged, weighted with their alpha.
+ * @param	image	The source-image.
+ * @param	target	The size of the result.
+ * @return	The downsampled image.
+ */
+static QImage boxFilter(const QImage &image, const QSize &target)
+{
+	QImage source = image.convertToFormat(QImage::Format_ARGB32);
+	QSize size = target.boundedTo(source.size());
+	QVector<quint64> sums(size.width() * size.height() * 4, 0);
+	QVector<quint64> counts(size.width() * size.height(), 0);
+
+	int x, y;
+	for(y = 0; y < source.height(); y++)
+	{
+		const QRgb *line = (const QRgb *)source.scanLine(y);
+		int ty = (int)((qint64)y * size.height() / source.height());
+		for(x = 0; x < source.width(); x++)
+		{
+			int tx = (int)((qint64)x * size.width() / source.width());
+			int i = ty * size.width() + tx;
+			int a = qAlpha(line[x]);
+			sums[i * 4] += a;
+			sums[i * 4 + 1] += qRed(line[x]) * a;
+			sums[i * 4 + 2] += qGreen(line[x]) * a;
+			sums[i * 4 + 3] += qBlue(line[x]) * a;
+			counts[i]++;
+		}
+	}
+
+	QImage result(size, QImage::Format_ARGB32);
+	for(y = 0; y < size.height(); y++)
+	{
+		QRgb *line = (QRgb *)result.scanLine(y);
+		for(x = 0; x < size.width(); x++)
+		{
+			const quint64 *s = sums.constData() + (y * size.width() + x) * 4;
+			quint64 n = counts.at(y * size.width() + x);
+			if(s[0] == 0 || n == 0) line[x] = 0;
+			else line[x] = qRgba(
+				(int)(s[1] / s[0]),
+				(int)(s[2] / s[0]),
+				(int)(s[3] / s[0]),
+				(int)(s[0] / n));
+		}
+	}
+	return result;
+}
+
+/**
+ * Function that returns the largest difference of a channel between two
+ * images of the same format.
+ * @param	a	The first image.
+ * @param	b	The second image.
+ * @return	The difference, 256 if the sizes differ.
+ */
+static int difference(const QImage &a, const QImage &b)
+{
+	if(a.size() != b.size()) return 256;
+
+	int result = 0;
+	int x, y;
+	for(y = 0; y < a.height(); y++)
+	{
+		const QRgb *p = (const QRgb *)a.scanLine(y);
+		const QRgb *q = (const QRgb *)b.scanLine(y);
+		for(x = 0; x < a.width(); x++)
+		{
+			result = qMax(result, qAbs(qRed(p[x]) - qRed(q[x])));
+			result = qMax(result, qAbs(qGreen(p[x]) - qGreen(q[x])));
+			result = qMax(result, qAbs(qBlue(p[x]) - qBlue(q[x])));
+			result = qMax(result, qAbs(qAlpha(p[x]) - qAlpha(q[x])));
+		}
+	}
+	return result;
+}
+
+/*****************************************************************************/
+
+/**
+ * Constructor of class PuMP_BenchmarkOptions, which sets the defaults.
+ */
+PuMP_BenchmarkOptions::PuMP_BenchmarkOptions()
+{
+	corrupt = BENCHMARK_CORRUPT;
+	count = BENCHMARK_COUNT;
+	downsample = 0;
+	huge = BENCHMARK_HUGE;
+	orientation = 0;
+	rows = 0;
+	threads = 0;
+
+	path = QDir::tempPath() + "/" + BENCHMARK_DIR;
+	runs = "both";
+	hugeSize = QSize(8000, 6000);
+	size = QSize(3000, 2000);
+	formats << "jpg" << "png" << "bmp";
+}
+
+/**
+ * Function that reads the options from the command-line.
+ * @param	arguments	The arguments of the application.
+ * @return	True on success, false if an option is invalid.
+ */
+bool PuMP_BenchmarkOptions::parse(const QStringList &arguments)
+{
+	int i;
+	for(i = 1; i < arguments.size(); i++)
+	{
+		QString option = arguments.at(i);
+		if(i + 1 >= arguments.size()) return false;
+		QString value = arguments.at(++i);
+
+		bool ok = true;
+		if(option == "--dir") path = value;
+		else if(option == "--count") count = value.toInt(&ok);
+		else if(option == "--corrupt") corrupt = value.toInt(&ok);
+		else if(option == "--downsample") downsample = value.toInt(&ok);
+		else if(option == "--huge") huge = value.toInt(&ok);
+		else if(option == "--orientation") orientation = value.toInt(&ok);
+		else if(option == "--rows") rows = value.toInt(&ok);
+		else if(option == "--threads") threads = value.toInt(&ok);
+		else if(option == "--formats") formats = value.split(',');
+		else if(option == "--run")
+		{
+			runs = value;
+			ok = runs == "cold" || runs == "warm" || runs == "both";
+		}
+		else if(option == "--size" || option == "--huge-size")
+		{
+			QSize s(
+				value.section('x', 0, 0).toInt(&ok),
+				value.section('x', 1, 1).toInt());
+			ok = ok && s.isValid() && !s.isEmpty();
+			if(option == "--size") size = s;
+			else hugeSize = s;
+		}
+		else return false;
+
+		if(!ok) return false;
+	}
+	return true;
+}
+
+/*****************************************************************************/
+
+/**
+ * Constructor of class PuMP_Benchmark. The benchmark drives the
+ * thumbnail-pipeline of the overview without any window: the directory is
+ * listed by PuMP_DirectoryReader, thumbnailed by PuMP_OverviewLoader and
+ * the results are committed to a PuMP_OverviewModel.
+ * @param	options	The options of the benchmark.
+ */
+PuMP_Benchmark::PuMP_Benchmark(const PuMP_BenchmarkOptions &options)
+	: QObject()
+{
+	this->options = options;
+	run = 0;
+	startMemory = 0;
+	model = NULL;
+
+	if(options.threads > 0) PuMP_MainWindow::settings->setValue(
+		PUMP_OVERVIEWLOADER_THREADS,
+		options.threads);
+	else PuMP_MainWindow::settings->remove(PUMP_OVERVIEWLOADER_THREADS);
+
+	loader = new PuMP_OverviewLoader(this);
+	reader = new PuMP_DirectoryReader(this);
+	connect(
+		loader,
+		SIGNAL(finished(int)),
+		this,
+		SLOT(on_loader_finished(int)));
+	connect(
+		loader,
+		SIGNAL(imageIsNull(int, int, const QString &)),
+		this,
+		SLOT(on_loader_imageIsNull(int, int, const QString &)));
+	connect(
+		loader,
+		SIGNAL(processedImage(
+			int,
+			int,
+			int,
+			const QString &,
+			const QString &,
+			const QImage &)),
+		this,
+		SLOT(on_loader_processedImage(
+			int,
+			int,
+			int,
+			const QString &,
+			const QString &,
+			const QImage &)));
+	connect(
+		reader,
+		SIGNAL(entriesAvailable(int)),
+		this,
+		SLOT(on_reader_entriesAvailable(int)));
+	connect(
+		reader,
+		SIGNAL(listingFinished(int)),
+		this,
+		SLOT(on_reader_listingFinished(int)));
+
+	commitTimer.setParent(this);
+	commitTimer.setSingleShot(true);
+	commitTimer.setInterval(COMMIT_INTERVAL);
+	connect(
+		&commitTimer,
+		SIGNAL(timeout()),
+		this,
+		SLOT(on_commitTimer_timeout()));
+}
+
+/**
+ * Destructor of class PuMP_Benchmark.
+ */
+PuMP_Benchmark::~PuMP_Benchmark()
+{
+	reader->stop();
+	loader->wait();
+	if(model != NULL) delete model;
+}
+
+/**
+ * Function that measures decoding PNG and BMP images of the given size into
+ * a thumbnail the given number of times, with PuMP_ScanlineReader and with
+ * QImageReader followed by QImage's smooth scaling. The results of the
+ * scanline-reader are compared to a reference box-filter applied to the
+ * image decoded as a whole.
+ */
+void PuMP_Benchmark::benchmarkDownsample()
+{
+	if(options.downsample <= 0) return;
+
+	int box = THUMB_SIZE << (THUMB_LEVELS - 1);
+	QSize target = options.size;
+	target.scale(QSize(box, box), Qt::KeepAspectRatio);
+	target = target.expandedTo(QSize(1, 1));
+
+	// one image for each PNG color-type the scanline-reader distinguishes
+	QImage image = createImage(options.size);
+	QImage alpha = image.convertToFormat(QImage::Format_ARGB32);
+	int x, y;
+	for(y = 0; y < alpha.height(); y++)
+	{
+		QRgb *line = (QRgb *)alpha.scanLine(y);
+		for(x = 0; x < alpha.width(); x++)
+			line[x] = qRgba(
+				qRed(line[x]),
+				qGreen(line[x]),
+				qBlue(line[x]),
+				(x + y) & 0xff);
+	}
+
+	QList<QImage> images;
+	QStringList files;
+	images << image << alpha;
+	files << "rgb.png" << "rgba.png";
+	images << image.convertToFormat(QImage::Format_Indexed8) << image;
+	files << "indexed.png" << "rgb.bmp";
+
+	printf("downsample, %dx%d to %dx%d, %d times\n",
+		options.size.width(),
+		options.size.height(),
+		target.width(),
+		target.height(),
+		options.downsample);
+
+	int i, j;
+	for(i = 0; i < images.size(); i++)
+	{
+		QString path = options.path + "/downsample-" + files.at(i);
+		if(!images.at(i).save(path))
+		{
+			printf("  %-11s not saved\n", files.at(i).toLocal8Bit().data());
+			continue;
+		}
+
+		QImage scanline;
+		time.start();
+		for(j = 0; j < options.downsample; j++)
+		{
+			QFile file(path);
+			if(!file.open(QIODevice::ReadOnly) ||
+				!PuMP_ScanlineReader::read(&file, target, scanline))
+				scanline = QImage();
+		}
+		int scanlineTime = time.restart();
+
+		for(j = 0; j < options.downsample; j++)
+		{
+			QImageReader reader(path);
+			reader.read().scaled(
+				target,
+				Qt::IgnoreAspectRatio,
+				Qt::SmoothTransformation);
+		}
+		int genericTime = time.elapsed();
+
+		int error = difference(scanline, boxFilter(QImage(path), target));
+		printf("  %-11s QImage %6d ms, scanline %6d ms",
+			files.at(i).toLocal8Bit().data(),
+			genericTime,
+			scanlineTime);
+		if(scanline.isNull()) printf(" (failed)\n");
+		else if(error > 0) printf(" (mismatch by %d)\n", error);
+		else printf("\n");
+	}
+}
+
+/**
+ * Function that measures the model alone with the given number of rows:
+ * appending them, reversing their order, scrolling through all of them a
+ * screen at a time, selecting rows all over the list and removing every
+ * second one.
+ */
+void PuMP_Benchmark::benchmarkModel()
+{
+	if(options.rows <= 0) return;
+
+	PuMP_OverviewModel rowModel;
+	QStringList names;
+	int i;
+	for(i = 0; i < options.rows; i++)
+		names.append(QString("image%1.jpg").arg(i, 8, 10, QChar('0')));
+
+	time.start();
+	for(i = 0; i < names.size(); i += READER_BATCH_SIZE)
+		rowModel.addEntries(names.mid(i, READER_BATCH_SIZE));
+	int addTime = time.restart();
+
+	QStringList reversed;
+	for(i = names.size() - 1; i >= 0; i--) reversed.append(names.at(i));
+	rowModel.reorder(reversed);
+	int reorderTime = time.restart();
+	long memory = peakMemory();
+
+	// every entry is loaded, only the thumbnails within the budget are kept
+	QImage thumbnail = createImage(QSize(THUMB_SIZE, THUMB_SIZE));
+	QList<PuMP_OverviewResult> results;
+	for(i = 0; i < names.size(); i++)
+	{
+		PuMP_OverviewResult result;
+		result.level = rowModel.getLevel();
+		result.name = names.at(i);
+		result.image = thumbnail;
+		results.append(result);
+		if(results.size() < READER_BATCH_SIZE && i + 1 < names.size())
+			continue;
+
+		rowModel.setImages(results);
+		results.clear();
+	}
+	time.restart();
+
+	// a screen shows BENCHMARK_SCREEN_ROWS rows, their thumbnails are created
+	// again as they are scrolled into view
+	int first;
+	for(first = 0; first < names.size(); first += BENCHMARK_SCREEN_ROWS)
+	{
+		int last = qMin(names.size(), first + BENCHMARK_SCREEN_ROWS) - 1;
+		rowModel.setVisibleRange(first, last);
+		QList<int> missing = rowModel.requestMissing(first, last);
+		for(i = 0; i < missing.size(); i++)
+		{
+			PuMP_OverviewResult result;
+			result.level = rowModel.getLevel();
+			result.name = rowModel.getItem(missing.at(i)).name;
+			result.image = thumbnail;
+			results.append(result);
+		}
+		rowModel.setImages(results);
+		results.clear();
+		for(i = first; i <= last; i++) rowModel.touch(i);
+	}
+	int scrollTime = time.restart();
+
+	int selected = qMin(names.size(), BENCHMARK_SELECTIONS);
+	int length = 0;
+	for(i = 0; i < selected; i++)
+	{
+		int row = (int)(((qint64)i * 7919) % names.size());
+		QModelIndex index = rowModel.index(row);
+		length += rowModel.getFileName(index).length();
+		length += rowModel.data(index, Qt::DisplayRole).toString().length();
+	}
+	int selectTime = time.restart();
+
+	for(i = 0; i < names.size(); i += 2)
+		rowModel.removeRows(
+			rowModel.getRowFromName(names.at(i)),
+			1,
+			QModelIndex());
+	int removeTime = time.elapsed();
+
+	printf("model, %d rows\n", options.rows);
+	printf("  add:            %8d ms\n", addTime);
+	printf("  reorder:        %8d ms\n", reorderTime);
+	printf("  scroll:         %8d ms (%d screens)\n",
+		scrollTime,
+		(names.size() + BENCHMARK_SCREEN_ROWS - 1) / BENCHMARK_SCREEN_ROWS);
+	printf("  select:         %8d ms (%d rows, %d chars)\n",
+		selectTime,
+		selected,
+		length);
+	printf("  remove half:    %8d ms\n", removeTime);
+	printf("  peak RSS:       %8ld KB (%+ld KB scrolling)\n",
+		peakMemory(),
+		peakMemory() - memory);
+}
+
+/**
+ * Function that measures rotating and mirroring an image of the given size
+ * the given number of times, with QImage's smooth transformation as the
+ * image-view used it and with PuMP_Orientation. The results of both are
+ * compared as well.
+ */
+void PuMP_Benchmark::benchmarkOrientation()
+{
+	if(options.orientation <= 0) return;
+
+	QList<QImage> images;
+	QStringList labels;
+	images << createImage(options.size);
+	labels << "32-bit";
+#if QT_VERSION >= 0x040400
+	images << images.first().convertToFormat(QImage::Format_RGB888);
+	labels << "24-bit";
+#endif
+
+	const int rotations[] = {90, 180, 270, 0, 0};
+	const bool horizontal[] = {false, false, false, true, false};
+	const char *names[] = {"rotate 90", "rotate 180", "rotate 270",
+		"mirror h", "mirror v"};
+
+	int i, j, k;
+	for(i = 0; i < images.size(); i++)
+	{
+		printf("orientation, %dx%d %s, %d times\n",
+			options.size.width(),
+			options.size.height(),
+			labels.at(i).toLocal8Bit().data(),
+			options.orientation);
+
+		const QImage &image = images.at(i);
+		for(j = 0; j < 5; j++)
+		{
+			QImage generic;
+			time.start();
+			for(k = 0; k < options.orientation; k++)
+			{
+				QMatrix matrix;
+				matrix.rotate(rotations[j]);
+				generic = image.transformed(matrix, Qt::SmoothTransformation);
+				generic = generic.mirrored(horizontal[j], j == 4);
+			}
+			int genericTime = time.restart();
+
+			QImage exact;
+			for(k = 0; k < options.orientation; k++)
+				exact = PuMP_Orientation::transform(
+					image,
+					rotations[j],
+					horizontal[j],
+					j == 4,
+					options.threads);
+			int exactTime = time.elapsed();
+
+			bool equal = exact == PuMP_Orientation::transformGeneric(
+				image,
+				rotations[j],
+				horizontal[j],
+				j == 4);
+			printf("  %-11s QImage %6d ms, exact %6d ms%s\n",
+				names[j],
+				genericTime,
+				exactTime,
+				equal ? "" : " (mismatch)");
+		}
+	}
+}
+
+/**
+ * Function that checks whether the current run is done, and starts the next
+ * one or quits.
+ */
+void PuMP_Benchmark::checkFinished()
+{
+	if(listing || loader->isRunning()) return;
+
+	commitTimer.stop();
+	on_commitTimer_timeout();
+	report(run == 0 ? "cold cache" : "warm cache");
+
+	run++;
+	if(run < 2 && options.runs == "both") startRun();
+	else
+	{
+		benchmarkModel();
+		benchmarkOrientation();
+		benchmarkDownsample();
+		QCoreApplication::quit();
+	}
+}
+
+/**
+ * Function that creates a synthetic image with some structure, so it
+ * compresses like a photo rather than like a plain area.
+ * @param	size	The dimensions of the image.
+ * @return	The image.
+ */
+QImage PuMP_Benchmark::createImage(const QSize &size)
+{
+	QImage image(size, QImage::Format_RGB32);
+	int x, y;
+	for(y = 0; y < size.height(); y++)
+	{
+		QRgb *line = (QRgb *)image.scanLine(y);
+		for(x = 0; x < size.width(); x++)
+			line[x] = qRgb(
+				x * 255 / size.width(),
+				y * 255 / size.height(),
+				((x ^ y) * 7) & 0xff);
+	}
+	return image;
+}
+
+/**
+ * Function that creates the synthetic directory, unless it exists already:
+ * count images of the given size in each format, a few truncated and
+ * garbage files and a few huge images.
+ * @return	True on success, false otherwise.
+ */
+bool PuMP_Benchmark::generate()
+{
+	dir.setPath(options.path + "/images");
+	if(dir.exists()) return true;
+	if(!dir.mkpath(dir.path())) return false;
+
+	time.start();
+	QImage image = createImage(options.size);
+	int i, j;
+	for(i = 0; i < options.count; i++)
+	{
+		const QString &format = options.formats.at(i % options.formats.size());
+		QString name = QString("image%1.").arg(i, 6, 10, QChar('0')) + format;
+		if(!image.save(dir.absoluteFilePath(name))) return false;
+	}
+
+	QImage huge = createImage(options.hugeSize);
+	for(i = 0; i < options.huge; i++)
+	{
+		QString name = QString("huge%1.jpg").arg(i);
+		if(!huge.save(dir.absoluteFilePath(name))) return false;
+	}
+
+	// half of the corrupt files are truncated, the others are garbage
+	QFile source(dir.absoluteFilePath(
+		"image000000." + options.formats.first()));
+	QByteArray valid;
+	if(source.open(QIODevice::ReadOnly)) valid = source.read(source.size() / 2);
+	for(i = 0; i < options.corrupt; i++)
+	{
+		QByteArray data = valid;
+		if(i % 2 == 1)
+		{
+			data.resize(64 * 1024);
+			for(j = 0; j < data.size(); j++) data[j] = (char)(j * 31 + i);
+		}
+
+		QFile file(dir.absoluteFilePath(
+			QString("corrupt%1.").arg(i) + options.formats.first()));
+		if(!file.open(QIODevice::WriteOnly)) return false;
+		file.write(data);
+	}
+
+	printf("generated %d images, %d huge and %d corrupt in %d ms\n",
+		options.count,
+		options.huge,
+		options.corrupt,
+		time.elapsed());
+	return true;
+}
+
+/**
+ * Function that returns the peak resident memory of the process. It only
+ * grows, so the runs after the first one report how much they added; for
+ * the peak of a warm run alone, see --run.
+ * @return	The peak memory in KB, or -1 if it is unknown.
+ */
+long PuMP_Benchmark::peakMemory()
+{
+#ifndef WINDOWS
+	struct rusage usage;
+	if(getrusage(RUSAGE_SELF, &usage) == 0)
+	{
+#ifdef Q_OS_MAC
+		return usage.ru_maxrss / 1024;
+#else
+		return usage.ru_maxrss;
+#endif
+	}
+#endif
+	return -1;
+}
+
+/**
+ * Function that prints the results of the current run.
+ * @param	label	The name of the run.
+ */
+void PuMP_Benchmark::report(const QString &label)
+{
+	int total = time.elapsed();
+	double rate = 0;
+	if(total > 0) rate = processed * 1000.0 / total;
+
+	printf("%s, %d threads\n",
+		label.toLocal8Bit().data(),
+		PuMP_MainWindow::settings->value(
+			PUMP_OVERVIEWLOADER_THREADS,
+			QThread::idealThreadCount()).toInt());
+	printf("  listing:        %8d ms\n", listingTime);
+	printf("  first thumbnail:%8d ms\n", firstThumbnail);
+	printf("  model commits:  %8d ms\n", commitTime);
+	printf("  total:          %8d ms\n", total);
+	printf("  thumbnails:     %8d (%d failed)\n", processed, failed);
+	printf("  thumbnails/s:   %8.1f\n", rate);
+
+	// summed over the workers, so they may exceed the total
+	PuMP_OverviewTimes stages = loader->takeTimes();
+	printf("  cache lookup:   %8d ms\n", stages.lookup);
+	printf("  decode:         %8d ms\n", stages.decode);
+	printf("  scale:          %8d ms\n", stages.scale);
+	printf("  cache store:    %8d ms\n", stages.store);
+	printf("  peak RSS:       %8ld KB (%+ld KB in this run)\n",
+		peakMemory(),
+		peakMemory() - startMemory);
+}
+
+/**
+ * Function that generates the directory and starts the first run.
+ * @return	True on success, false otherwise.
+ */
+bool PuMP_Benchmark::start()
+{
+	if(!generate()) return false;
+
+	// the cache of the benchmark is kept apart from the user's one, see
+	// main(), and is emptied for the cold run; a warm run on its own uses
+	// the cache the last cold run left
+	if(options.runs == "warm") run = 1;
+	else
+	{
+		QDir cache(QDir::homePath() + "/" + THUMBNAIL_CACHE_DIR);
+		QStringList files = cache.entryList(QDir::Files);
+		int i;
+		for(i = 0; i < files.size(); i++) cache.remove(files.at(i));
+	}
+
+	startRun();
+	return true;
+}
+
+/**
+ * Function that starts a run with a new model and thumbnail-cache. The
+ * thumbnail-cache of the previous run is written back first, the workers
+ * are idle at that point.
+ */
+void PuMP_Benchmark::startRun()
+{
+	if(model != NULL) delete model;
+	if(PuMP_MainWindow::thumbnailCache != NULL)
+		delete PuMP_MainWindow::thumbnailCache;
+
+	PuMP_MainWindow::thumbnailCache = new PuMP_ThumbnailCache();
+	model = new PuMP_OverviewModel();
+
+	commitTime = 0;
+	failed = 0;
+	firstThumbnail = -1;
+	listingTime = 0;
+	processed = 0;
+	listing = true;
+	results.clear();
+
+	// every row counts as visible, so the model keeps all thumbnails the
+	// budget allows
+	model->setVisibleRange(0, INT_MAX);
+	loader->setFocus(0, INT_MAX);
+
+	startMemory = peakMemory();
+	loader->takeTimes();
+	time.start();
+	generation = loader->restart();
+	reader->read(dir.path(), PuMP_MainWindow::nameFilters, generation);
+}
+
+/**
+ * Slot-function that commits the collected thumbnails to the model, as the
+ * overview does.
+ */
+void PuMP_Benchmark::on_commitTimer_timeout()
+{
+	if(results.isEmpty()) return;
+
+	QTime commit;
+	commit.start();
+	model->setImages(results);
+	commitTime += commit.elapsed();
+	results.clear();
+}
+
+/**
+ * Slot-function that is called when the loader processed all queued jobs.
+ * @param	generation	The generation of the finished jobs.
+ */
+void PuMP_Benchmark::on_loader_finished(int generation)
+{
+	if(generation != this->generation) return;
+	checkFinished();
+}
+
+/**
+ * Slot-function that counts the files that couldn't be thumbnailed.
+ * @param	generation	The generation of the failed job.
+ * @param	index		The index of the file.
+ * @param	fileName	The file that failed to load.
+ */
+void PuMP_Benchmark::on_loader_imageIsNull(
+	int generation,
+	int index,
+	const QString &fileName)
+{
+	Q_UNUSED(index);
+	Q_UNUSED(fileName);
+	if(generation != this->generation) return;
+	failed++;
+}
+
+/**
+ * Slot-function that collects a finished thumbnail.
+ * @param	generation	The generation of the processed job.
+ * @param	index		The index of the file.
+ * @param	level		The level of the thumbnail.
+ * @param	name		The file-name of the image.
+ * @param	properties	The property-string of the image.
+ * @param	image		The thumbnail.
+ */
+void PuMP_Benchmark::on_loader_processedImage(
+	int generation,
+	int index,
+	int level,
+	const QString &name,
+	const QString &properties,
+	const QImage &image)
+{
+	Q_UNUSED(index);
+	if(generation != this->generation) return;
+
+	if(firstThumbnail < 0) firstThumbnail = time.elapsed();
+	processed++;
+
+	PuMP_OverviewResult result;
+	result.level = level;
+	result.name = name;
+	result.properties = properties;
+	result.image = image;
+	results.append(result);
+	if(!commitTimer.isActive()) commitTimer.start();
+}
+
+/**
+ * Slot-function that appends newly listed entries to the model and queues
+ * them for thumbnailing.
+ * @param	generation	The generation of the listing.
+ */
+void PuMP_Benchmark::on_reader_entriesAvailable(int generation)
+{
+	if(generation != this->generation) return;
+
+	QList<QFileInfo> infos = reader->takeEntries();
+	QStringList names;
+	int i;
+	for(i = 0; i < infos.size(); i++) names.append(infos.at(i).fileName());
+	model->addEntries(names);
+	loader->processImages(infos, model->rowCount(QModelIndex()) - infos.size());
+}
+
+/**
+ * Slot-function that is called when the directory was listed completely.
+ * @param	generation	The generation of the listing.
+ */
+void PuMP_Benchmark::on_reader_listingFinished(int generation)
+{
+	if(generation != this->generation) return;
+
+	listingTime = time.elapsed();
+	listing = false;
+	checkFinished();
+}
+
+/*****************************************************************************/
+
+/**
+ * Main-function of the benchmark. The home-directory is pointed into the
+ * benchmark-directory, so neither the user's settings nor the user's
+ * thumbnail-caches are touched.
+ */
+int main(int argc, char *argv[])
+{
+	QApplication app(argc, argv);
+
+	PuMP_BenchmarkOptions options;
+	if(!options.parse(app.arguments()) || options.formats.isEmpty())
+	{
+		printf("usage: %s [--dir PATH] [--count N] [--size WxH] "
+			"[--formats jpg,png,bmp] [--corrupt N] [--huge N] "
+			"[--huge-size WxH] [--threads N] [--rows N] "
+			"[--orientation N] [--downsample N] "
+			"[--run cold|warm|both]\n",
+			argv[0]);
+		return 1;
+	}
+
+	QDir().mkpath(options.path + "/home");
+	qputenv("HOME", QFile::encodeName(options.path + "/home"));
+	qputenv("XDG_CACHE_HOME", QFile::encodeName(options.path + "/home/.cache"));
+	PuMP_MainWindow::settings = new QSettings(
+		options.path + "/benchmark.ini",
+		INI_SETTINGS_FORMAT);
+	PuMP_MainWindow::nameFilters
+		<< "*.jpg" << "*.jpeg" << "*.png" << "*.bmp";
+
+	PuMP_Benchmark benchmark(options);
+	if(!benchmark.start())
+	{
+		printf("failed to create \"%s\"\n", options.path.toLocal8Bit().data());
+		return 1;
+	}
+
+	int result = app.exec();
+	delete PuMP_MainWindow::thumbnailCache;
+	PuMP_MainWindow::thumbnailCache = NULL;
+	return result;
+}
+
+/*****************************************************************************/
@@ -0,0 +1,136 @@
+/*
+ * Copyright 2007 Christoph Werle, Tobias Schlager
+ * 
+ * This file is part of "PuMP - Publish My Pictures".
+ *
+ * "Publish My Pictures" is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * "Publish My Pictures" is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with "Publish My Pictures"; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ */
+
+#ifndef BENCHMARK_HH_
+#define BENCHMARK_HH_
+
+#include <QDir>
+#include <QImage>
+#include <QList>
+#include <QObject>
+#include <QSize>
+#include <QString>
+#include <QStringList>
+#include <QTime>
+#include <QTimer>
+
+#include "src/overview.hh"
+
+/******************************************************************************/
+
+#define BENCHMARK_DIR		"pump-benchmark"
+#define BENCHMARK_COUNT		200
+#define BENCHMARK_CORRUPT	2
+#define BENCHMARK_HUGE		1
+#define BENCHMARK_SCREEN_ROWS	64
+#define BENCHMARK_SELECTIONS	100000
+
+/******************************************************************************/
+
+class PuMP_BenchmarkOptions
+{
+	public:
+		int corrupt;
+		int count;
+		int downsample;
+		int huge;
+		int orientation;
+		int rows;
+		int threads;
+
+		QString path;
+		QString runs;
+		QSize hugeSize;
+		QSize size;
+		QStringList formats;
+
+		PuMP_BenchmarkOptions();
+
+		bool parse(const QStringList &arguments);
+};
+
+/******************************************************************************/
+
+class PuMP_Benchmark : public QObject
+{
+	Q_OBJECT
+
+	protected:
+		int commitTime;
+		int failed;
+		int firstThumbnail;
+		int generation;
+		int listingTime;
+		int processed;
+		int run;
+		long startMemory;
+		bool listing;
+
+		PuMP_BenchmarkOptions options;
+		PuMP_OverviewModel *model;
+		PuMP_OverviewLoader *loader;
+		PuMP_DirectoryReader *reader;
+
+		QDir dir;
+		QList<PuMP_OverviewResult> results;
+		QTime time;
+		QTimer commitTimer;
+
+		void benchmarkDownsample();
+		void benchmarkModel();
+		void benchmarkOrientation();
+		void checkFinished();
+		bool generate();
+		QImage createImage(const QSize &size);
+		void report(const QString &label);
+		void startRun();
+
+		static long peakMemory();
+
+	public:
+		PuMP_Benchmark(const PuMP_BenchmarkOptions &options);
+		~PuMP_Benchmark();
+
+		bool start();
+
+	public slots:
+		void on_commitTimer_timeout();
+
+		void on_reader_entriesAvailable(int generation);
+		void on_reader_listingFinished(int generation);
+
+		void on_loader_finished(int generation);
+		void on_loader_imageIsNull(
+			int generation,
+			int index,
+			const QString &fileName);
+		void on_loader_processedImage(
+			int generation,
+			int index,
+			int level,
+			const QString &name,
+			const QString &properties,
+			const QImage &image);
+};
+
+/******************************************************************************/
+
+#endif /*BENCHMARK_HH_*/
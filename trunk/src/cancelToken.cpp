@@ -0,0 +1,96 @@
+/*
+ * Copyright 2007 Christoph Werle, Tobias Schlager
+ * 
+ * This file is part of "PuMP - Publish My Pictures".
+ *
+ * "Publish My Pictures" is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * "Publish My Pictures" is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with "Publish My Pictures"; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ */
+
+#include <QMutexLocker>
+
+#include "cancelToken.hh"
+
+/*****************************************************************************/
+
+/**
+ * Constructor of class PuMP_CancelToken. A token is shared between the
+ * thread doing some long-running work and the one that may abort it. The
+ * worker checks the token at points where it can stop cleanly.
+ */
+PuMP_CancelToken::PuMP_CancelToken()
+{
+	cancelled = false;
+}
+
+/**
+ * Function that requests the work guarded by this token to stop.
+ */
+void PuMP_CancelToken::cancel()
+{
+	QMutexLocker locker(&mutex);
+	cancelled = true;
+}
+
+/**
+ * Function that tells whether the work guarded by this token should stop.
+ * @return	True if the work was cancelled, false otherwise.
+ */
+bool PuMP_CancelToken::isCancelled() const
+{
+	QMutexLocker locker(&mutex);
+	return cancelled;
+}
+
+/**
+ * Function that makes this token usable for new work.
+ */
+void PuMP_CancelToken::reset()
+{
+	QMutexLocker locker(&mutex);
+	cancelled = false;
+}
+
+/*****************************************************************************/
+
+/**
+ * Constructor of class PuMP_CancellableFile. Reading from the file fails as
+ * soon as the token is cancelled, so image-readers decoding from it give up
+ * after the current chunk instead of decoding the whole file.
+ * @param	name	The name of the file.
+ * @param	token	The token to check before each chunk is read.
+ */
+PuMP_CancellableFile::PuMP_CancellableFile(
+	const QString &name,
+	const PuMP_CancelToken *token)
+	: QFile(name)
+{
+	this->token = token;
+}
+
+/**
+ * Overloaded function that reads the next chunk unless the token is
+ * cancelled.
+ * @param	data	The buffer to read into.
+ * @param	maxSize	The size of the buffer.
+ * @return	The number of bytes read or -1 on error or if cancelled.
+ */
+qint64 PuMP_CancellableFile::readData(char *data, qint64 maxSize)
+{
+	if(token != NULL && token->isCancelled()) return -1;
+	return QFile::readData(data, maxSize);
+}
+
+/*****************************************************************************/
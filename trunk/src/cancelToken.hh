@@ -0,0 +1,62 @@
+/*
+ * Copyright 2007 Christoph Werle, Tobias Schlager
+ * 
+ * This file is part of "PuMP - Publish My Pictures".
+ *
+ * "Publish My Pictures" is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * "Publish My Pictures" is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with "Publish My Pictures"; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ */
+
+#ifndef CANCELTOKEN_HH_
+#define CANCELTOKEN_HH_
+
+#include <QFile>
+#include <QMutex>
+#include <QString>
+
+/******************************************************************************/
+
+class PuMP_CancelToken
+{
+	protected:
+		bool cancelled;
+		mutable QMutex mutex;
+
+	public:
+		PuMP_CancelToken();
+
+		void cancel();
+		bool isCancelled() const;
+		void reset();
+};
+
+/******************************************************************************/
+
+class PuMP_CancellableFile : public QFile
+{
+	protected:
+		const PuMP_CancelToken *token;
+
+		qint64 readData(char *data, qint64 maxSize);
+
+	public:
+		PuMP_CancellableFile(
+			const QString &name,
+			const PuMP_CancelToken *token);
+};
+
+/******************************************************************************/
+
+#endif /*CANCELTOKEN_HH_*/
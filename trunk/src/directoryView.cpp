@@ -135,7 +135,8 @@ PuMP_DirectoryView::~PuMP_DirectoryView()
 }
 
 /**
- * Function to append file-info-objects to the directory-history.
+ * Function to append file-info-objects to the directory-history. The
+ * directories visited before are announced by historyChanged().
  * @param	info	The info to append.
  */
 void PuMP_DirectoryView::appendToHistory(const QFileInfo &info)
@@ -166,6 +167,12 @@ void PuMP_DirectoryView::appendToHistory(const QFileInfo &info)
 		PuMP_MainWindow::forwardAction->setEnabled(
 			historyCurrent < (history.size() - 1));
 	}
+
+	QStringList paths;
+	int i;
+	for(i = historyCurrent; i >= 0; i--)
+		paths.append(history.at(i).filePath());
+	emit historyChanged(paths);
 }
 
 /**
@@ -26,6 +26,7 @@
 #include <QDirModel>
 #include <QFileInfo>
 #include <QList>
+#include <QStringList>
 #include <QTreeView>
 
 /*****************************************************************************/
@@ -65,6 +66,7 @@ class PuMP_DirectoryView : public QTreeView
 		void on_refreshAction_triggered();
 	
 	signals:
+		void historyChanged(const QStringList &paths);
 		void openImage(const QFileInfo &info, bool newPage);
 };
 
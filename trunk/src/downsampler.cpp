@@ -0,0 +1,529 @@
+/*
+ * Copyright 2007 Christoph Werle, Tobias Schlager
+ * 
+ * This file is part of "PuMP - Publish My Pictures".
+ *
+ * "Publish My Pictures" is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * "Publish My Pictures" is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with "Publish My Pictures"; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ */
+
+#include <string.h>
+
+extern "C" {
+	#include "src/zlib/zlib.h"
+}
+
+#include "downsampler.hh"
+
+/*****************************************************************************/
+
+/**
+ * Constructor of class PuMP_Downsampler. The downsampler takes the lines of
+ * an image one after another and averages all source-pixels falling into a
+ * target-pixel (box-filter). Only one line of sums is kept besides the
+ * result, no matter how large the source is.
+ * @param	source	The size of the source-image.
+ * @param	target	The size of the result, not larger than the source.
+ */
+PuMP_Downsampler::PuMP_Downsampler(const QSize &source, const QSize &target)
+	: source(source), target(target.boundedTo(source))
+{
+	line = -1;
+	rows = 0;
+	result = QImage(this->target, QImage::Format_ARGB32);
+	result.fill(0);
+
+	columns.resize(source.width());
+	counts.fill(0, this->target.width());
+	sums.fill(0, this->target.width() * 4);
+
+	int x;
+	for(x = 0; x < source.width(); x++)
+	{
+		columns[x] = (int)((qint64)x * this->target.width() / source.width());
+		counts[columns.at(x)]++;
+	}
+}
+
+/**
+ * Function that adds a line of the source-image. The lines may arrive from
+ * top to bottom or from bottom to top.
+ * @param	y		The number of the line.
+ * @param	pixels	The pixels of the line, as many as the source is wide.
+ */
+void PuMP_Downsampler::addLine(int y, const QRgb *pixels)
+{
+	if(y < 0 || y >= source.height()) return;
+
+	int ty = (int)((qint64)y * target.height() / source.height());
+	if(ty != line)
+	{
+		flush();
+		line = ty;
+	}
+
+	// the colors are weighted with their alpha, so transparent pixels don't
+	// darken the result
+	quint64 *sum = sums.data();
+	int x;
+	for(x = 0; x < source.width(); x++)
+	{
+		QRgb p = pixels[x];
+		int a = qAlpha(p);
+		quint64 *s = sum + columns.at(x) * 4;
+		s[0] += a;
+		s[1] += qRed(p) * a;
+		s[2] += qGreen(p) * a;
+		s[3] += qBlue(p) * a;
+	}
+	rows++;
+}
+
+/**
+ * Function that writes the averaged line into the result and clears the sums.
+ */
+void PuMP_Downsampler::flush()
+{
+	if(line < 0 || rows == 0) return;
+
+	QRgb *out = (QRgb *)result.scanLine(line);
+	quint64 *sum = sums.data();
+	int x;
+	for(x = 0; x < target.width(); x++)
+	{
+		quint64 *s = sum + x * 4;
+		quint64 n = (quint64)counts.at(x) * rows;
+		if(s[0] == 0 || n == 0) out[x] = 0;
+		else out[x] = qRgba(
+			(int)(s[1] / s[0]),
+			(int)(s[2] / s[0]),
+			(int)(s[3] / s[0]),
+			(int)(s[0] / n));
+		s[0] = s[1] = s[2] = s[3] = 0;
+	}
+	rows = 0;
+}
+
+/**
+ * Function that returns the downsampled image.
+ * @return	The result.
+ */
+QImage PuMP_Downsampler::image()
+{
+	flush();
+	line = -1;
+	return result;
+}
+
+/*****************************************************************************/
+
+/**
+ * Function that reads a 16-bit little-endian value.
+ */
+static int le16(const uchar *data)
+{
+	return data[0] | (data[1] << 8);
+}
+
+/**
+ * Function that reads a 32-bit little-endian value.
+ */
+static qint32 le32(const uchar *data)
+{
+	return (qint32)(data[0] | (data[1] << 8) | (data[2] << 16) |
+		((quint32)data[3] << 24));
+}
+
+/**
+ * Function that reads a 32-bit big-endian value.
+ */
+static quint32 be32(const uchar *data)
+{
+	return ((quint32)data[0] << 24) | (data[1] << 16) | (data[2] << 8) |
+		data[3];
+}
+
+/**
+ * Function that skips the data of a chunk. Lengths beyond PNG_MAX_CHUNK or
+ * the end of the device are refused, seeking there would succeed.
+ */
+static bool skip(QIODevice *device, quint32 length)
+{
+	qint64 target = device->pos() + length;
+	if(length > PNG_MAX_CHUNK || target > device->size()) return false;
+	return device->seek(target);
+}
+
+/**
+ * Function that decodes an image line by line and downsamples it on the
+ * fly, so that the decoded image never has to be kept in memory. Supported
+ * are uncompressed BMP and non-interlaced PNG, the formats QImageReader can't
+ * scale while decoding.
+ * @param	device	The device to read from, positioned at the start of the
+ * 					image.
+ * @param	target	The size of the result.
+ * @param	result	Returns the downsampled image.
+ * @param	token	If given, the decoding stops as soon as it is cancelled.
+ * @return	True on success, false if the format isn't supported, the image
+ * 			is damaged or the decoding was cancelled.
+ */
+bool PuMP_ScanlineReader::read(
+	QIODevice *device,
+	const QSize &target,
+	QImage &result,
+	const PuMP_CancelToken *token)
+{
+	result = QImage();
+	if(!target.isValid() || target.isEmpty()) return false;
+
+	QByteArray magic = device->peek(8);
+	if(magic.size() == 8 &&
+		memcmp(magic.constData(), "\x89PNG\r\n\x1a\n", 8) == 0)
+		return readPng(device, target, result, token);
+	if(magic.size() >= 2 && magic[0] == 'B' && magic[1] == 'M')
+		return readBmp(device, target, result, token);
+	return false;
+}
+
+/**
+ * Function that decodes an uncompressed 24- or 32-bit BMP line by line.
+ * @param	device	The device to read from.
+ * @param	target	The size of the result.
+ * @param	result	Returns the downsampled image.
+ * @param	token	If given, the decoding stops as soon as it is cancelled.
+ * @return	True on success, false otherwise.
+ */
+bool PuMP_ScanlineReader::readBmp(
+	QIODevice *device,
+	const QSize &target,
+	QImage &result,
+	const PuMP_CancelToken *token)
+{
+	QByteArray header = device->read(14 + 40);
+	if(header.size() < 14 + 40) return false;
+	const uchar *data = (const uchar *)header.constData();
+
+	qint32 offset = le32(data + 10);
+	if(le32(data + 14) < 40) return false;
+	qint32 width = le32(data + 18);
+	qint32 height = le32(data + 22);
+	int bpp = le16(data + 28);
+	qint32 compression = le32(data + 30);
+	if(width <= 0 || height == 0 || compression != 0) return false;
+	if(bpp != 24 && bpp != 32) return false;
+
+	// positive heights are stored from bottom to top
+	bool bottomUp = height > 0;
+	if(!bottomUp) height = -height;
+	if(!device->seek(offset)) return false;
+
+	PuMP_Downsampler downsampler(
+		QSize(width, height),
+		target.boundedTo(QSize(width, height)));
+	int rowBytes = ((width * (bpp / 8)) + 3) & ~3;
+	int step = bpp / 8;
+	QVector<QRgb> pixels(width);
+
+	int i;
+	for(i = 0; i < height; i++)
+	{
+		if(token != NULL && token->isCancelled()) return false;
+
+		QByteArray row = device->read(rowBytes);
+		if(row.size() < rowBytes) return false;
+		const uchar *p = (const uchar *)row.constData();
+
+		int x;
+		for(x = 0; x < width; x++, p += step)
+			pixels[x] = qRgb(p[2], p[1], p[0]);
+
+		downsampler.addLine(bottomUp ? height - 1 - i : i, pixels.constData());
+	}
+
+	result = downsampler.image();
+	return true;
+}
+
+/**
+ * Function that reverses the PNG-filter of a line.
+ * @param	type	The filter-type.
+ * @param	line	The filtered line, reversed in place.
+ * @param	prior	The previous (unfiltered) line.
+ * @param	size	The number of bytes of a line.
+ * @param	bpp		The number of bytes of a pixel, at least one.
+ * @return	False for unknown filter-types.
+ */
+static bool unfilter(
+	int type,
+	uchar *line,
+	const uchar *prior,
+	int size,
+	int bpp)
+{
+	int i;
+	switch(type)
+	{
+		case 0:
+			break;
+		case 1:
+			for(i = bpp; i < size; i++) line[i] += line[i - bpp];
+			break;
+		case 2:
+			for(i = 0; i < size; i++) line[i] += prior[i];
+			break;
+		case 3:
+			for(i = 0; i < size; i++)
+			{
+				int a = i >= bpp ? line[i - bpp] : 0;
+				line[i] += (a + prior[i]) / 2;
+			}
+			break;
+		case 4:
+			for(i = 0; i < size; i++)
+			{
+				int a = i >= bpp ? line[i - bpp] : 0;
+				int b = prior[i];
+				int c = i >= bpp ? prior[i - bpp] : 0;
+				int p = a + b - c;
+				int pa = qAbs(p - a);
+				int pb = qAbs(p - b);
+				int pc = qAbs(p - c);
+				if(pa <= pb && pa <= pc) line[i] += a;
+				else if(pb <= pc) line[i] += b;
+				else line[i] += c;
+			}
+			break;
+		default:
+			return false;
+	}
+	return true;
+}
+
+/**
+ * Function that decodes a non-interlaced PNG line by line. The image-data
+ * is inflated right into a buffer holding a single line.
+ * @param	device	The device to read from.
+ * @param	target	The size of the result.
+ * @param	result	Returns the downsampled image.
+ * @param	token	If given, the decoding stops as soon as it is cancelled.
+ * @return	True on success, false otherwise.
+ */
+bool PuMP_ScanlineReader::readPng(
+	QIODevice *device,
+	const QSize &target,
+	QImage &result,
+	const PuMP_CancelToken *token)
+{
+	device->read(8);
+
+	int width = 0;
+	int height = 0;
+	int depth = 0;
+	int colorType = 0;
+	int channels = 0;
+	int rowBytes = 0;
+	int bpp = 1;
+	QVector<QRgb> palette;
+
+	PuMP_Downsampler *downsampler = NULL;
+	QByteArray line;
+	QByteArray prior;
+	QVector<QRgb> pixels;
+	int filled = 0;
+	int y = 0;
+
+	z_stream stream;
+	memset(&stream, 0, sizeof(stream));
+	if(inflateInit(&stream) != Z_OK) return false;
+
+	bool ok = false;
+	bool done = false;
+	while(!done)
+	{
+		QByteArray chunk = device->read(8);
+		if(chunk.size() < 8) break;
+		quint32 length = be32((const uchar *)chunk.constData());
+		QByteArray type = chunk.mid(4, 4);
+
+		// the chunks read as a whole have a fixed or a small maximal size
+		if(type == "IHDR")
+		{
+			if(length != 13) break;
+			QByteArray ihdr = device->read(length);
+			if(ihdr.size() < 13) break;
+			const uchar *data = (const uchar *)ihdr.constData();
+
+			width = (int)be32(data);
+			height = (int)be32(data + 4);
+			depth = data[8];
+			colorType = data[9];
+			if(width <= 0 || height <= 0 || data[12] != 0) break;
+
+			if(colorType == 0) channels = 1;
+			else if(colorType == 2) channels = 3;
+			else if(colorType == 3) channels = 1;
+			else if(colorType == 4) channels = 2;
+			else if(colorType == 6) channels = 4;
+			else break;
+			if(depth != 1 && depth != 2 && depth != 4 &&
+				depth != 8 && depth != 16) break;
+			if(depth < 8 && colorType != 0 && colorType != 3) break;
+
+			rowBytes = (int)(((qint64)width * channels * depth + 7) / 8);
+			bpp = qMax(1, channels * depth / 8);
+			line.fill(0, rowBytes + 1);
+			prior.fill(0, rowBytes);
+			pixels.resize(width);
+			downsampler = new PuMP_Downsampler(
+				QSize(width, height),
+				target.boundedTo(QSize(width, height)));
+		}
+		else if(type == "PLTE")
+		{
+			if(length > 3 * 256 || length % 3 != 0) break;
+			QByteArray plte = device->read(length);
+			const uchar *data = (const uchar *)plte.constData();
+			int i;
+			for(i = 0; i + 2 < plte.size(); i += 3)
+				palette.append(qRgb(data[i], data[i + 1], data[i + 2]));
+		}
+		else if(type == "tRNS" && colorType == 3)
+		{
+			if(length > 256) break;
+			QByteArray trns = device->read(length);
+			int i;
+			for(i = 0; i < trns.size() && i < palette.size(); i++)
+			{
+				QRgb c = palette.at(i);
+				palette[i] = qRgba(
+					qRed(c),
+					qGreen(c),
+					qBlue(c),
+					(uchar)trns.at(i));
+			}
+		}
+		else if(type == "IDAT")
+		{
+			if(downsampler == NULL || length > PNG_MAX_CHUNK) break;
+
+			bool error = false;
+			while(length > 0 && !error && y < height)
+			{
+				if(token != NULL && token->isCancelled())
+				{
+					error = true;
+					break;
+				}
+
+				QByteArray input = device->read(
+					qMin(length, (quint32)SCANLINE_CHUNK_SIZE));
+				if(input.isEmpty())
+				{
+					error = true;
+					break;
+				}
+				length -= input.size();
+
+				stream.next_in = (Bytef *)input.data();
+				stream.avail_in = input.size();
+				while(stream.avail_in > 0 && y < height)
+				{
+					stream.next_out = (Bytef *)line.data() + filled;
+					stream.avail_out = rowBytes + 1 - filled;
+					int status = inflate(&stream, Z_NO_FLUSH);
+					filled = rowBytes + 1 - stream.avail_out;
+					if(status != Z_OK && status != Z_STREAM_END)
+					{
+						error = true;
+						break;
+					}
+					if(filled < rowBytes + 1)
+					{
+						if(status == Z_STREAM_END) break;
+						continue;
+					}
+
+					uchar *data = (uchar *)line.data() + 1;
+					const uchar *previous = (const uchar *)prior.constData();
+					if(!unfilter(line.at(0), data, previous, rowBytes, bpp))
+					{
+						error = true;
+						break;
+					}
+
+					int x;
+					int shift = 8 - depth;
+					int max = (1 << qMin(depth, 8)) - 1;
+					int step = depth / 8;
+					for(x = 0; x < width; x++)
+					{
+						const uchar *p = data + x * channels * step;
+						int v = 0;
+						if(depth < 8)
+						{
+							int bit = x * depth;
+							v = (data[bit / 8] >> (shift - bit % 8)) & max;
+						}
+
+						if(colorType == 0)
+						{
+							int g = depth < 8 ? v * 255 / max : p[0];
+							pixels[x] = qRgb(g, g, g);
+						}
+						else if(colorType == 2)
+							pixels[x] = qRgb(p[0], p[step], p[2 * step]);
+						else if(colorType == 3)
+						{
+							if(depth == 8) v = p[0];
+							pixels[x] = v < palette.size() ? palette.at(v) : 0;
+						}
+						else if(colorType == 4)
+							pixels[x] = qRgba(p[0], p[0], p[0], p[step]);
+						else pixels[x] = qRgba(
+							p[0],
+							p[step],
+							p[2 * step],
+							p[3 * step]);
+					}
+
+					downsampler->addLine(y, pixels.constData());
+					memcpy(prior.data(), data, rowBytes);
+					filled = 0;
+					y++;
+				}
+			}
+			if(error) break;
+			if(length > 0 && !skip(device, length)) break;
+		}
+		else if(type == "IEND") break;
+		else if(!skip(device, length)) break;
+
+		// the CRC is not checked, the rest of the file is not needed once
+		// all lines are decoded
+		device->read(4);
+		if(downsampler != NULL && y == height)
+		{
+			ok = true;
+			done = true;
+		}
+	}
+
+	inflateEnd(&stream);
+	if(ok && downsampler != NULL) result = downsampler->image();
+	delete downsampler;
+	return ok;
+}
+
+/*****************************************************************************/
@@ -0,0 +1,89 @@
+/*
+ * Copyright 2007 Christoph Werle, Tobias Schlager
+ * 
+ * This file is part of "PuMP - Publish My Pictures".
+ *
+ * "Publish My Pictures" is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * "Publish My Pictures" is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with "Publish My Pictures"; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ */
+
+#ifndef DOWNSAMPLER_HH_
+#define DOWNSAMPLER_HH_
+
+#include <QByteArray>
+#include <QColor>
+#include <QImage>
+#include <QIODevice>
+#include <QSize>
+#include <QVector>
+
+#include "cancelToken.hh"
+
+/******************************************************************************/
+
+#define SCANLINE_CHUNK_SIZE	65536
+#define PNG_MAX_CHUNK		0x7fffffff
+
+/******************************************************************************/
+
+class PuMP_Downsampler
+{
+	protected:
+		int line;
+		int rows;
+		QSize source;
+		QSize target;
+		QImage result;
+
+		QVector<int> columns;
+		QVector<int> counts;
+		QVector<quint64> sums;
+
+		void flush();
+
+	public:
+		PuMP_Downsampler(const QSize &source, const QSize &target);
+
+		void addLine(int y, const QRgb *pixels);
+		QImage image();
+};
+
+/******************************************************************************/
+
+class PuMP_ScanlineReader
+{
+	protected:
+		static bool readBmp(
+			QIODevice *device,
+			const QSize &target,
+			QImage &result,
+			const PuMP_CancelToken *token);
+		static bool readPng(
+			QIODevice *device,
+			const QSize &target,
+			QImage &result,
+			const PuMP_CancelToken *token);
+
+	public:
+		static bool read(
+			QIODevice *device,
+			const QSize &target,
+			QImage &result,
+			const PuMP_CancelToken *token = 0);
+};
+
+/******************************************************************************/
+
+#endif /*DOWNSAMPLER_HH_*/
@@ -0,0 +1,165 @@
+/*
+ * Copyright 2007 Christoph Werle, Tobias Schlager
+ * 
+ * This file is part of "PuMP - Publish My Pictures".
+ *
+ * "Publish My Pictures" is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * "Publish My Pictures" is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with "Publish My Pictures"; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ */
+
+#include <string.h>
+
+#include <QByteArray>
+
+#include "exif.hh"
+
+/*****************************************************************************/
+
+/**
+ * Function that reads an unsigned 16-bit value of the TIFF-structure.
+ * @param	data		Pointer on the value.
+ * @param	motorola	True for big-endian, false for little-endian.
+ * @return	The value.
+ */
+quint16 PuMP_Exif::get16(const uchar *data, bool motorola)
+{
+	if(motorola) return (data[0] << 8) | data[1];
+	else return (data[1] << 8) | data[0];
+}
+
+/**
+ * Function that reads an unsigned 32-bit value of the TIFF-structure.
+ * @param	data		Pointer on the value.
+ * @param	motorola	True for big-endian, false for little-endian.
+ * @return	The value.
+ */
+quint32 PuMP_Exif::get32(const uchar *data, bool motorola)
+{
+	if(motorola)
+		return ((quint32)get16(data, true) << 16) | get16(data + 2, true);
+	else return ((quint32)get16(data + 2, false) << 16) | get16(data, false);
+}
+
+/**
+ * Function that looks for the thumbnail in the second IFD of a TIFF-structure
+ * and decodes it straight from the given buffer.
+ * @param	data		The TIFF-structure (starting at its header).
+ * @param	size		The size of the TIFF-structure.
+ * @param	thumbnail	Returns the decoded thumbnail.
+ * @return	True if a thumbnail was found and decoded, false otherwise.
+ */
+bool PuMP_Exif::readTiff(
+	const uchar *data,
+	quint32 size,
+	QImage &thumbnail)
+{
+	if(size < 8) return false;
+
+	bool motorola;
+	if(data[0] == 'M' && data[1] == 'M') motorola = true;
+	else if(data[0] == 'I' && data[1] == 'I') motorola = false;
+	else return false;
+	if(get16(data + 2, motorola) != 42) return false;
+
+	// skip IFD0, its link leads to IFD1 describing the thumbnail; all
+	// bounds are checked by adding in 64 bits, so nothing wraps around
+	quint32 ifd = get32(data + 4, motorola);
+	if((quint64)ifd + 2 > size) return false;
+	quint32 link = ifd + 2 + get16(data + ifd, motorola) * 12;
+	if((quint64)link + 4 > size) return false;
+
+	ifd = get32(data + link, motorola);
+	if(ifd == 0 || (quint64)ifd + 2 > size) return false;
+
+	quint32 offset = 0;
+	quint32 length = 0;
+	quint16 count = get16(data + ifd, motorola);
+	int i;
+	for(i = 0; i < count; i++)
+	{
+		quint32 entry = ifd + 2 + i * 12;
+		if((quint64)entry + 12 > size) return false;
+
+		quint16 tag = get16(data + entry, motorola);
+		quint16 type = get16(data + entry + 2, motorola);
+		quint32 value;
+		if(type == 3) value = get16(data + entry + 8, motorola);
+		else value = get32(data + entry + 8, motorola);
+
+		if(tag == 0x0201) offset = value;
+		else if(tag == 0x0202) length = value;
+	}
+
+	if(offset == 0 || length == 0) return false;
+	if((quint64)offset + length > size) return false;
+
+	return thumbnail.loadFromData(data + offset, length, "JPEG");
+}
+
+/**
+ * Function that extracts the thumbnail most cameras embed in the EXIF-data
+ * (APP1-segment) of a JPEG-file. Only the segment-headers and the
+ * APP1-segment itself are read, usually a few KB at the start of the file.
+ * The thumbnail is decoded straight from the read segment.
+ * @param	device		The device to read from, positioned at the start of
+ * 						the file.
+ * @param	thumbnail	Returns the decoded thumbnail.
+ * @return	True if a thumbnail was found and decoded, false otherwise.
+ */
+bool PuMP_Exif::readThumbnail(QIODevice *device, QImage &thumbnail)
+{
+	thumbnail = QImage();
+
+	QByteArray soi = device->read(2);
+	if(soi.size() < 2 || (uchar)soi[0] != 0xFF || (uchar)soi[1] != 0xD8)
+		return false;
+
+	int i;
+	for(i = 0; i < EXIF_MAX_SEGMENTS; i++)
+	{
+		QByteArray header = device->read(4);
+		if(header.size() < 4) return false;
+
+		const uchar *data = (const uchar *)header.constData();
+		if(data[0] != 0xFF) return false;
+
+		// the image-data starts, no more metadata
+		uchar marker = data[1];
+		if(marker == 0xDA || marker == 0xD9) return false;
+
+		int length = (data[2] << 8) | data[3];
+		if(length < 2) return false;
+
+		if(marker != 0xE1)
+		{
+			if(!device->seek(device->pos() + length - 2)) return false;
+			continue;
+		}
+
+		QByteArray segment = device->read(length - 2);
+		if(segment.size() < length - 2) return false;
+		if(segment.size() < 6 || memcmp(segment.constData(), "Exif\0\0", 6))
+			continue;
+
+		return readTiff(
+			(const uchar *)segment.constData() + 6,
+			segment.size() - 6,
+			thumbnail);
+	}
+
+	return false;
+}
+
+/*****************************************************************************/
@@ -0,0 +1,50 @@
+/*
+ * Copyright 2007 Christoph Werle, Tobias Schlager
+ * 
+ * This file is part of "PuMP - Publish My Pictures".
+ *
+ * "Publish My Pictures" is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * "Publish My Pictures" is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with "Publish My Pictures"; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ */
+
+#ifndef EXIF_HH_
+#define EXIF_HH_
+
+#include <QImage>
+#include <QIODevice>
+
+/******************************************************************************/
+
+#define EXIF_MAX_SEGMENTS	16
+
+/******************************************************************************/
+
+class PuMP_Exif
+{
+	protected:
+		static quint16 get16(const uchar *data, bool motorola);
+		static quint32 get32(const uchar *data, bool motorola);
+		static bool readTiff(
+			const uchar *data,
+			quint32 size,
+			QImage &thumbnail);
+
+	public:
+		static bool readThumbnail(QIODevice *device, QImage &thumbnail);
+};
+
+/******************************************************************************/
+
+#endif /*EXIF_HH_*/
@@ -21,6 +21,7 @@
 
 #include "exportDialog.hh"
 #include "mainWindow.hh"
+#include "resampler.hh"
 
 #include <QDebug>
 #include <QDir>
@@ -589,12 +590,10 @@ void PuMP_ExportWidget::on_watermarkSpinBoxW_editingFinished()
 	
 	if(!watermark.isNull())
 	{
-		watermarkScaled = watermark;
-		watermarkScaled = watermarkScaled.scaled(
-			watermarkSpinBoxW_value,
-			watermarkSpinBoxH_value,
-			Qt::IgnoreAspectRatio,
-			Qt::SmoothTransformation);
+		watermarkScaled = QPixmap::fromImage(PuMP_Resampler::scale(
+			watermark.toImage(),
+			QSize(watermarkSpinBoxW_value, watermarkSpinBoxH_value),
+			PuMP_Resampler::Lanczos));
 		label1->setMinimumSize(watermarkScaled.size());
 		label1->setPixmap(watermarkScaled);
 		label1->updateGeometry();
@@ -615,12 +614,10 @@ void PuMP_ExportWidget::on_watermarkSpinBoxH_editingFinished()
 
 	if(!watermark.isNull())
 	{
-		watermarkScaled = watermark;
-		watermarkScaled = watermarkScaled.scaled(
-			watermarkSpinBoxW_value,
-			watermarkSpinBoxH_value,
-			Qt::IgnoreAspectRatio,
-			Qt::SmoothTransformation);
+		watermarkScaled = QPixmap::fromImage(PuMP_Resampler::scale(
+			watermark.toImage(),
+			QSize(watermarkSpinBoxW_value, watermarkSpinBoxH_value),
+			PuMP_Resampler::Lanczos));
 		label1->setMinimumSize(watermarkScaled.size());
 		label1->setPixmap(watermarkScaled);
 		label1->updateGeometry();
@@ -27,33 +27,167 @@
 #include <QFile>
 #include <QFileDialog>
 #include <QHBoxLayout>
+#include <QImageReader>
 #include <QList>
 #include <QMatrix>
 #include <QMenu>
 #include <QMessageBox>
 #include <QMouseEvent>
+#include <QMutexLocker>
 #include <QPainter>
 #include <QPaintEvent>
+#include <QResizeEvent>
 #include <QScrollBar>
+#include <QStringList>
 
+#include "downsampler.hh"
 #include "imageView.hh"
 #include "mainWindow.hh"
+#include "orientation.hh"
+#include "resampler.hh"
+#include "siblingIndex.hh"
 #include "tabView.hh"
+#include "thumbnailCache.hh"
 
 /*****************************************************************************/
 
 /**
- * Constructor of class PuMP_Display that sets this displays image and is
- * responsible for painting it. Can be OpenGL-supported if PuMP was compiled
- * with the appropriate flag.
+ * Constructor of class PuMP_Display that is responsible for painting the
+ * image. The image is kept as a pyramid of halved copies, only the tiles of
+ * the level closest to the current scale that intersect the visible area are
+ * painted. Rotation and mirroring are applied to these tiles only, the image
+ * itself is left untouched.
  * @param	parent	The parent widget of this view.
  */
 PuMP_Display::PuMP_Display(QWidget *parent)
 	: QWidget(parent)
 {
+	mirroredHorizontal = false;
+	mirroredVertical = false;
+	rotation = 0;
+	scale = 1;
+	tiles.setMaxCost(TILE_CACHE * 1024);
 	setSizePolicy(QSizePolicy::Ignored, QSizePolicy::Ignored);
 }
 
+/**
+ * Function that returns the size of the image at full resolution, as it is
+ * displayed (i.e. rotated).
+ * @return	The size of the image.
+ */
+QSize PuMP_Display::getImageSize() const
+{
+	if(pyramid.isEmpty()) return QSize();
+
+	QSize size = imageSize;
+	if(rotation == 90 || rotation == 270) size.transpose();
+	return size;
+}
+
+/**
+ * Function that returns the pyramid-level to paint from at the current
+ * scale. It is the smallest one that still has at least the resolution
+ * needed.
+ * @return	The level.
+ */
+int PuMP_Display::getLevel() const
+{
+	int level = 0;
+	while(level + 1 < pyramid.size() &&
+		pyramid.at(level + 1).width() >= imageSize.width() * scale)
+		level++;
+	return level;
+}
+
+/**
+ * Function that returns the matrix mapping the pixels of a pyramid-level to
+ * the widget: rotated first, then mirrored, then scaled and finally moved by
+ * the offset of the visible area.
+ * @param	level	The pyramid-level.
+ * @return	The matrix.
+ */
+QMatrix PuMP_Display::getMatrix(int level) const
+{
+	const QImage &source = pyramid.at(level);
+	int w = source.width();
+	int h = source.height();
+
+	QMatrix matrix;
+	if(rotation == 90) matrix = QMatrix(0, 1, -1, 0, h, 0);
+	else if(rotation == 180) matrix = QMatrix(-1, 0, 0, -1, w, h);
+	else if(rotation == 270) matrix = QMatrix(0, -1, 1, 0, 0, w);
+	if(rotation == 90 || rotation == 270) qSwap(w, h);
+
+	if(mirroredHorizontal) matrix *= QMatrix(-1, 0, 0, 1, w, 0);
+	if(mirroredVertical) matrix *= QMatrix(1, 0, 0, -1, 0, h);
+
+	double factor = scale * imageSize.width() / source.width();
+	matrix *= QMatrix(factor, 0, 0, factor, -offset.x(), -offset.y());
+	return matrix;
+}
+
+/**
+ * Function that returns the scale the image is displayed with.
+ * @return	The scale, 1 for the original size.
+ */
+double PuMP_Display::getScale() const
+{
+	return scale;
+}
+
+/**
+ * Function that returns the size of the image as it is displayed, i.e.
+ * rotated and scaled. The widget itself only covers the visible area.
+ * @return	The scaled size, an empty size if there is no image.
+ */
+QSize PuMP_Display::getScaledSize() const
+{
+	if(pyramid.isEmpty()) return QSize(0, 0);
+
+	QSize size = getImageSize();
+	return QSize(
+		qMax(1, (int)(size.width() * scale)),
+		qMax(1, (int)(size.height() * scale)));
+}
+
+/**
+ * Function that returns a tile of a pyramid-level as pixmap, rotated and
+ * mirrored like the image is displayed. Tiles are converted on first use and
+ * kept in a cache sized by resizeEvent().
+ * @param	level	The pyramid-level.
+ * @param	x		The column of the tile.
+ * @param	y		The row of the tile.
+ * @return	The tile.
+ */
+QPixmap *PuMP_Display::getTile(int level, int x, int y)
+{
+	qint64 key = ((qint64)level << 48) | ((qint64)y << 24) | x;
+	QPixmap *tile = tiles.object(key);
+	if(tile != NULL) return tile;
+
+	QRect area(x * TILE_SIZE, y * TILE_SIZE, TILE_SIZE, TILE_SIZE);
+	area = area.intersected(pyramid.at(level).rect());
+	QImage image = PuMP_Orientation::transform(
+		pyramid.at(level).copy(area),
+		rotation,
+		mirroredHorizontal,
+		mirroredVertical,
+		1);
+
+	tile = new QPixmap(QPixmap::fromImage(image));
+	tiles.insert(key, tile, area.width() * area.height() * 4 / 1024 + 1);
+	return tile;
+}
+
+/**
+ * Function that returns whether there is an image to display.
+ * @return	True if there is no image, false otherwise.
+ */
+bool PuMP_Display::isNull() const
+{
+	return pyramid.isEmpty();
+}
+
 /**
  * The overloaded function that handles mouse-press-events for this widget.
  * @param	event	The mouse-event that occured.
@@ -65,38 +199,370 @@ void PuMP_Display::mousePressEvent(QMouseEvent *event)
 		if(PuMP_MainWindow::sizeOriginalAction->isEnabled())
 			PuMP_MainWindow::sizeOriginalAction->trigger();
 		else PuMP_MainWindow::sizeFittedAction->trigger();
-
-		adjustSize();
 	}
 	else event->ignore();
 }
 
 /**
- * Overloaded function that handles paint-events for this widget. It simply
- * paints the picture the image-variable contains.
+ * Overloaded function that handles paint-events for this widget. Only the
+ * tiles intersecting the area to update are painted, so the costs depend on
+ * the size of the screen rather than on the size of the image.
  * @param	event	The paint-event that occured. 
  */
 void PuMP_Display::paintEvent(QPaintEvent *event)
 {
-	if(image.isNull()) resize(QSize(1, 1));
-	else
-	{	
-		QPainter painter(this);
-		painter.setClipRegion(event->region());
-		painter.drawPixmap(event->rect(), image, event->rect());
+	if(pyramid.isEmpty()) return;
+
+	int level = getLevel();
+	const QImage &source = pyramid.at(level);
+	QMatrix matrix = getMatrix(level);
+
+	QPainter painter(this);
+	painter.setClipRegion(event->region());
+	if(scale * imageSize.width() != source.width())
+		painter.setRenderHint(QPainter::SmoothPixmapTransform);
+
+	QRectF area = matrix.inverted().mapRect(QRectF(event->rect()));
+	int first = qMax(0, (int)area.left() / TILE_SIZE);
+	int last = qMin(
+		(source.width() - 1) / TILE_SIZE,
+		(int)area.right() / TILE_SIZE);
+	int top = qMax(0, (int)area.top() / TILE_SIZE);
+	int bottom = qMin(
+		(source.height() - 1) / TILE_SIZE,
+		(int)area.bottom() / TILE_SIZE);
+
+	// all transformations keep the edges axis-parallel, adjacent tiles
+	// share their rounded edges, so there are no gaps in between
+	int x, y;
+	for(y = top; y <= bottom; y++)
+	{
+		for(x = first; x <= last; x++)
+		{
+			QRect tileArea(
+				x * TILE_SIZE,
+				y * TILE_SIZE,
+				TILE_SIZE,
+				TILE_SIZE);
+			tileArea = tileArea.intersected(source.rect());
+			QRectF mapped = matrix.mapRect(QRectF(tileArea));
+			QRect target(
+				QPoint(qRound(mapped.left()), qRound(mapped.top())),
+				QPoint(
+					qRound(mapped.right()) - 1,
+					qRound(mapped.bottom()) - 1));
+
+			QPixmap *tile = getTile(level, x, y);
+			painter.drawPixmap(target, *tile, tile->rect());
+		}
+	}
+}
+
+/**
+ * Overloaded function that handles resize-events for this widget. The tile
+ * cache holds TILE_SCREENS times the visible area (the level painted from has
+ * up to twice the resolution of the screen in each direction), but at least
+ * TILE_CACHE MB, so panning doesn't convert the same tiles over and over.
+ * @param	event	The resize-event that occured.
+ */
+void PuMP_Display::resizeEvent(QResizeEvent *event)
+{
+	QSize size = event->size();
+	tiles.setMaxCost(qMax(
+		TILE_CACHE * 1024,
+		TILE_SCREENS * size.width() * size.height() * 4 / 1024));
+}
+
+/**
+ * Function that sets which part of the scaled image is visible, the widget
+ * is as large as the viewport of the scroll-area. The painted pixels are
+ * moved, only the newly exposed strip is painted again.
+ * @param	offset	The position of the widget's top-left corner in the
+ * 					scaled image.
+ */
+void PuMP_Display::setOffset(const QPoint &offset)
+{
+	if(offset == this->offset) return;
+
+	QPoint delta = this->offset - offset;
+	this->offset = offset;
+	scroll(delta.x(), delta.y());
+}
+
+/**
+ * Function that sets the image to display as pyramid, see
+ * PuMP_ImageProcessor::createPyramid(). The image may have been decoded at
+ * a lower resolution than its own, it's stretched to its own size then.
+ * @param	pyramid		The image and its halved copies.
+ * @param	imageSize	The size of the image at full resolution.
+ */
+void PuMP_Display::setPyramid(
+	const QList<QImage> &pyramid,
+	const QSize &imageSize)
+{
+	this->pyramid = pyramid;
+	this->imageSize = imageSize;
+	tiles.clear();
+	update();
+}
+
+/**
+ * Function that sets the scale the image is displayed with. No pixels are
+ * processed, the tiles are only painted at another size.
+ * @param	scale	The scale, 1 for the original size.
+ */
+void PuMP_Display::setScale(double scale)
+{
+	this->scale = scale;
+	update();
+}
+
+/**
+ * Function that sets how the image is rotated and mirrored. Only the tiles
+ * are transformed, once they are painted.
+ * @param	rotation			The rotation clockwise in degrees, a multiple
+ * 								of 90.
+ * @param	mirroredHorizontal	True to mirror the rotated image
+ * 								horizontally.
+ * @param	mirroredVertical	True to mirror the rotated image vertically.
+ */
+void PuMP_Display::setTransform(
+	int rotation,
+	bool mirroredHorizontal,
+	bool mirroredVertical)
+{
+	this->rotation = ((rotation % 360) + 360) % 360;
+	this->mirroredHorizontal = mirroredHorizontal;
+	this->mirroredVertical = mirroredVertical;
+	tiles.clear();
+	update();
+}
+
+/*****************************************************************************/
+
+/**
+ * Constructor of class PuMP_ImagePrefetcher, a thread that decodes the
+ * images next to the one being displayed in advance, so stepping through a
+ * directory doesn't have to wait for the decoder. The images are decoded
+ * only as large as the view and kept as pyramids in a cache of
+ * PREFETCH_MEMORY MB. There is one prefetcher for all image-views, see
+ * PuMP_MainWindow::prefetcher; it follows the view that showed an image
+ * last.
+ * @param	parent	The parent of this class.
+ */
+PuMP_ImagePrefetcher::PuMP_ImagePrefetcher(QObject *parent) : QThread(parent)
+{
+	backwards = false;
+	moved = false;
+	shutdown = false;
+
+	int memory = PREFETCH_MEMORY;
+	if(PuMP_MainWindow::settings != NULL)
+		memory = PuMP_MainWindow::settings->value(
+			PUMP_IMAGEPREFETCHER_MEMORY,
+			PREFETCH_MEMORY).toInt();
+	cache.setMaxCost(qMax(0, memory) * 1024);
+}
+
+/**
+ * Destructor of class PuMP_ImagePrefetcher, which stops the thread.
+ */
+PuMP_ImagePrefetcher::~PuMP_ImagePrefetcher()
+{
+	mutex.lock();
+	shutdown = true;
+	token.cancel();
+	condition.wakeAll();
+	mutex.unlock();
+	wait();
+}
+
+/**
+ * Function that puts a decoded image into the cache, e.g. the one that was
+ * displayed before.
+ * @param	info		The image-file.
+ * @param	pyramid		The pyramid of the image.
+ * @param	imageSize	The size of the image at full resolution.
+ */
+void PuMP_ImagePrefetcher::insert(
+	const QFileInfo &info,
+	const QList<QImage> &pyramid,
+	const QSize &imageSize)
+{
+	QMutexLocker locker(&mutex);
+	insertLocked(info, pyramid, imageSize);
+}
+
+/**
+ * Function that puts a decoded image into the cache, its cost is its size in
+ * KB. The mutex has to be locked.
+ * @param	info		The image-file.
+ * @param	pyramid		The pyramid of the image.
+ * @param	imageSize	The size of the image at full resolution.
+ */
+void PuMP_ImagePrefetcher::insertLocked(
+	const QFileInfo &info,
+	const QList<QImage> &pyramid,
+	const QSize &imageSize)
+{
+	if(pyramid.isEmpty()) return;
+
+	int cost = 0;
+	int i;
+	for(i = 0; i < pyramid.size(); i++)
+		cost += pyramid.at(i).numBytes() / 1024;
+
+	PuMP_PrefetchedImage *entry = new PuMP_PrefetchedImage();
+	entry->lastModified = QFileInfo(info.filePath()).lastModified();
+	entry->imageSize = imageSize;
+	entry->pyramid = pyramid;
+	cache.insert(info.filePath(), entry, cost);
+}
+
+/**
+ * Function that tells the prefetcher which image is displayed now. The
+ * PREFETCH_AHEAD images following it in the direction of travel are decoded
+ * first, then the PREFETCH_BEHIND ones before it; all others are dropped.
+ * @param	info		The image displayed.
+ * @param	backwards	True if the user steps to the previous images.
+ * @param	fit			The size of the view, the images are decoded to fit
+ * 						into it.
+ */
+void PuMP_ImagePrefetcher::prefetch(
+	const QFileInfo &info,
+	bool backwards,
+	const QSize &fit)
+{
+	QMutexLocker locker(&mutex);
+	center = info;
+	this->fit = fit;
+	this->backwards = backwards;
+	moved = true;
+	condition.wakeAll();
+
+	if(!isRunning()) start(QThread::LowPriority);
+}
+
+/**
+ * The overloaded main-function of this thread. The neighbours are looked up
+ * in the sibling-index whenever the displayed image changed, then the queued
+ * images are decoded one after another.
+ */
+void PuMP_ImagePrefetcher::run()
+{
+	mutex.lock();
+	while(!shutdown)
+	{
+		if(moved)
+		{
+			moved = false;
+			QFileInfo info = center;
+			bool back = this->backwards;
+			mutex.unlock();
+
+			int step = back ? -1 : 1;
+			QList<QFileInfo> wanted;
+			int i;
+			for(i = 1; i <= PREFETCH_AHEAD; i++)
+			{
+				QFileInfo next = PuMP_MainWindow::siblingIndex->getSibling(
+					info,
+					i * step);
+				if(!next.fileName().isEmpty()) wanted.append(next);
+			}
+			for(i = 1; i <= PREFETCH_BEHIND; i++)
+			{
+				QFileInfo next = PuMP_MainWindow::siblingIndex->getSibling(
+					info,
+					-i * step);
+				if(!next.fileName().isEmpty()) wanted.append(next);
+			}
+
+			mutex.lock();
+			if(moved) continue;
+
+			// images out of reach are dropped, as is the running decode
+			QStringList keep;
+			for(i = 0; i < wanted.size(); i++)
+				keep.append(wanted.at(i).filePath());
+			QList<QString> keys = cache.keys();
+			for(i = 0; i < keys.size(); i++)
+				if(!keep.contains(keys.at(i))) cache.remove(keys.at(i));
+			if(!current.isEmpty() && !keep.contains(current)) token.cancel();
+
+			queue = wanted;
+			continue;
+		}
+
+		if(queue.isEmpty())
+		{
+			condition.wait(&mutex);
+			continue;
+		}
+
+		QFileInfo info = queue.takeFirst();
+		if(cache.contains(info.filePath())) continue;
+
+		current = info.filePath();
+		QSize size = fit;
+		token.reset();
+		mutex.unlock();
+
+		QSize imageSize;
+		QImage image = PuMP_ImageProcessor::decode(
+			info.filePath(),
+			size,
+			imageSize,
+			&token);
+		QList<QImage> pyramid;
+		if(!token.isCancelled())
+			pyramid = PuMP_ImageProcessor::createPyramid(image, &token);
+
+		mutex.lock();
+		current.clear();
+		if(!token.isCancelled()) insertLocked(info, pyramid, imageSize);
+		condition.wakeAll();
 	}
+	mutex.unlock();
 }
 
 /**
- * The overloaded function that is called from other widgets to obtain a
- * suitable size-value for this widget.
+ * Function that takes an image out of the cache. If the image is decoded
+ * right now, the function waits for it, that's still faster than decoding
+ * it again.
+ * @param	info		The image-file.
+ * @param	pyramid		Returns the pyramid of the image.
+ * @param	imageSize	Returns the size of the image at full resolution.
+ * @param	token		If given, the waiting stops as soon as it is
+ * 						cancelled.
+ * @return	True on success, false if the image isn't cached or the file
+ * 			was modified since.
  */
-QSize PuMP_Display::sizeHint() const
+bool PuMP_ImagePrefetcher::take(
+	const QFileInfo &info,
+	QList<QImage> &pyramid,
+	QSize &imageSize,
+	const PuMP_CancelToken *token)
 {
-	QSize dsize = size();
-	if(!image.isNull()) dsize = image.size();
+	QMutexLocker locker(&mutex);
+	while(!current.isEmpty() && current == info.filePath())
+	{
+		if(token != NULL && token->isCancelled()) return false;
+		condition.wait(&mutex, PREFETCH_POLL);
+	}
+
+	PuMP_PrefetchedImage *entry = cache.take(info.filePath());
+	if(entry == NULL) return false;
 
-	return dsize;
+	bool valid =
+		entry->lastModified == QFileInfo(info.filePath()).lastModified();
+	if(valid)
+	{
+		pyramid = entry->pyramid;
+		imageSize = entry->imageSize;
+	}
+	delete entry;
+	return valid;
 }
 
 /*****************************************************************************/
@@ -109,6 +575,9 @@ QSize PuMP_Display::sizeHint() const
 PuMP_ImageProcessor::PuMP_ImageProcessor(QObject *parent) : QThread(parent)
 {
 	processingFinished = true;
+	backwards = false;
+	cancelled = false;
+	fullResolution = false;
 	hasNext = false;
 	hasPrevious = false;
 	mirroredHorizontal = false;
@@ -119,6 +588,101 @@ PuMP_ImageProcessor::PuMP_ImageProcessor(QObject *parent) : QThread(parent)
 	mode = PuMP_ImageView::None;
 }
 
+/**
+ * Destructor of class PuMP_ImageProcessor, which stops the thread at its
+ * next checkpoint.
+ */
+PuMP_ImageProcessor::~PuMP_ImageProcessor()
+{
+	token.cancel();
+	wait();
+}
+
+/**
+ * Function that creates the pyramid the image is displayed from. Each level
+ * has half the width and height of the one before, the last one fits into
+ * PYRAMID_MIN_SIZE pixels.
+ * @param	image	The image at full resolution, the first level.
+ * @param	token	If given, the levels aren't completed once it is
+ * 					cancelled.
+ * @return	The levels, largest first, none if cancelled.
+ */
+QList<QImage> PuMP_ImageProcessor::createPyramid(
+	const QImage &image,
+	const PuMP_CancelToken *token)
+{
+	QList<QImage> pyramid;
+	if(image.isNull()) return pyramid;
+
+	pyramid.append(image);
+	while(pyramid.last().width() > PYRAMID_MIN_SIZE ||
+		pyramid.last().height() > PYRAMID_MIN_SIZE)
+	{
+		const QImage &level = pyramid.last();
+		QImage next = PuMP_Resampler::scale(
+			level,
+			QSize(qMax(1, level.width() / 2), qMax(1, level.height() / 2)),
+			PuMP_Resampler::Area,
+			0,
+			token);
+		if(next.isNull()) return QList<QImage>();
+		pyramid.append(next);
+	}
+	return pyramid;
+}
+
+/**
+ * Function that decodes an image. Images larger than the given size are
+ * decoded to fit into it right away, which is far faster for JPEG and keeps
+ * the decoded image small.
+ * @param	path		The image-file.
+ * @param	fit			The size to fit the image into, an invalid size to
+ * 						decode it at full resolution.
+ * @param	imageSize	Returns the size of the image at full resolution.
+ * @param	token		If given, the decoding stops as soon as it is
+ * 						cancelled.
+ * @return	The decoded image, a null-image on failure.
+ */
+QImage PuMP_ImageProcessor::decode(
+	const QString &path,
+	const QSize &fit,
+	QSize &imageSize,
+	const PuMP_CancelToken *token)
+{
+	imageSize = QSize();
+	PuMP_CancellableFile file(path, token);
+	if(!file.open(QIODevice::ReadOnly)) return QImage();
+
+	QImageReader reader(&file);
+	imageSize = reader.size();
+
+	QSize target;
+	if(imageSize.isValid() && fit.isValid() && !fit.isEmpty() &&
+		(imageSize.width() > fit.width() || imageSize.height() > fit.height()))
+	{
+		target = imageSize;
+		target.scale(fit, Qt::KeepAspectRatio);
+		target = target.expandedTo(QSize(1, 1));
+	}
+
+	// PNG and BMP can't be scaled while decoding, they are downsampled line
+	// by line instead of decoded as a whole
+	QImage image;
+	if(target.isValid() && file.seek(0))
+		PuMP_ScanlineReader::read(&file, target, image, token);
+
+	if(image.isNull() && file.seek(0))
+	{
+		reader.setDevice(&file);
+		if(target.isValid()) reader.setScaledSize(target);
+		image = reader.read();
+	}
+
+	if(token != NULL && token->isCancelled()) return QImage();
+	if(!imageSize.isValid()) imageSize = image.size();
+	return image;
+}
+
 /**
  * Function that returns a file-info-object pointing to the current images
  * successor in its directory.
@@ -129,38 +693,45 @@ PuMP_ImageProcessor::PuMP_ImageProcessor(QObject *parent) : QThread(parent)
  */
 QFileInfo PuMP_ImageProcessor::getSuccessor(bool previous) const
 {
-	QFileInfo succ;
-	if(previous && !hasPrevious) return succ;
-	if(!previous && !hasNext) return succ;
-	if(!info.exists()) return succ;
+	if(previous && !hasPrevious) return QFileInfo();
+	if(!previous && !hasNext) return QFileInfo();
 
-	QList<QFileInfo> list = info.dir().entryInfoList(
-		PuMP_MainWindow::nameFilters, QDir::Files);
-	int index = list.indexOf(info);
-	if(previous && index == 0) return succ;
-	if(!previous && index == (list.size() - 1)) return succ;
-	
-	if(previous) index--;
-	else index++;
-	
-	succ = list.at(index);
-	return succ;
+	return PuMP_MainWindow::siblingIndex->getSibling(info, previous ? -1 : 1);
 }
 
 /**
  * The overloaded main-function of this thread, which processed the (given)
  * image. On success an imageProcessed-signal will be emitted,
- * otherwise an error-signal will be emitted.
+ * otherwise an error-signal will be emitted. New images are decoded only as
+ * large as the view, the cached thumbnail is offered as placeholder
+ * meanwhile. The full resolution is decoded on demand.
  */
 void PuMP_ImageProcessor::run()
 {
-	bool newImage = false;
 	processingFinished = false;
+	cancelled = false;
+	// info already points to the requested image, the one left behind was
+	// kept when the request was made
+	QFileInfo previous = shown;
 
-	if(mode == PuMP_ImageView::LoadImage)
+	if(mode == PuMP_ImageView::LoadFullResolution)
 	{
-		image.load(info.filePath());
-		newImage = true;
+		QSize size;
+		QImage full = decode(info.filePath(), QSize(), size, &token);
+		QList<QImage> levels = createPyramid(full, &token);
+
+		processingFinished = true;
+		if(token.isCancelled()) cancelled = true;
+		else if(levels.isEmpty()) emit error(info.filePath());
+		else
+		{
+			image = full;
+			imageSize = size;
+			fullResolution = true;
+			pyramid = levels;
+			emit imageProcessed();
+		}
+		return;
 	}
 	else if(mode == PuMP_ImageView::LoadNextImage)
 	{
@@ -173,8 +744,6 @@ void PuMP_ImageProcessor::run()
 		}
 		
 		info = next;
-		image.load(info.filePath());
-		newImage = true;
 	}
 	else if(mode == PuMP_ImageView::LoadPreviousImage)
 	{
@@ -187,45 +756,8 @@ void PuMP_ImageProcessor::run()
 		}
 		
 		info = prev;
-		image.load(info.filePath());
-		newImage = true;
-	}
-	else if(mode == PuMP_ImageView::MirrorHorizontally)
-	{
-		mirroredHorizontal = !mirroredHorizontal;
-	}
-	else if(mode == PuMP_ImageView::MirrorVertically)
-	{
-		mirroredVertical = !mirroredVertical;
-	}
-	else if(mode == PuMP_ImageView::ResizeToOriginal)
-	{
-		zoom = DEFAULT_ZOOM;
-		scaled = false;
-	}
-	else if(mode == PuMP_ImageView::ResizeToFitted)
-	{
-		scaled = true;
-	}
-	else if(mode == PuMP_ImageView::RotateClockWise)
-	{
-		rotation = (rotation + 90) % 360;
-	}
-	else if(mode == PuMP_ImageView::RotateCounterClockWise)
-	{
-		rotation = (rotation - 90) % 360;
-	}
-	else if(mode == PuMP_ImageView::ZoomIn)
-	{
-		if(zoom < MAX_ZOOM_STEPS) zoom++;
-		scaled = false;
-	}
-	else if(mode == PuMP_ImageView::ZoomOut)
-	{
-		if(zoom > 0) zoom--;
-		scaled = false;
 	}
-	else
+	else if(mode != PuMP_ImageView::LoadImage)
 	{
 		qDebug() << "Unknown action demanded";
 		processingFinished = true;
@@ -233,64 +765,65 @@ void PuMP_ImageProcessor::run()
 		return;
 	}
 
-	QImage result;
-	if(newImage)
+	// the image left behind may be wanted again soon, the prefetcher keeps
+	// it as long as it is next to the new one
+	PuMP_ImagePrefetcher *prefetcher = PuMP_MainWindow::prefetcher;
+	if(prefetcher != NULL && !pyramid.isEmpty() && previous != info)
+		prefetcher->insert(previous, pyramid, imageSize);
+
+	// neither zooming nor rotating and mirroring need the processor, the
+	// display transforms the visible tiles of the pyramid while painting
+	QList<QImage> levels;
+	QSize size;
+	if(prefetcher == NULL || !prefetcher->take(info, levels, size, &token))
 	{
-		if(image.isNull())
-		{
-			processingFinished = true;
-			emit error(info.filePath());
-			return;
-		}
+		QList<QImage> thumbnails;
+		QSize thumbnailSize;
+		if(PuMP_MainWindow::thumbnailCache != NULL &&
+			PuMP_MainWindow::thumbnailCache->lookup(
+				info,
+				thumbnails,
+				thumbnailSize) &&
+			!thumbnails.isEmpty())
+			emit placeholderReady(thumbnails.last(), thumbnailSize);
 
-		QList<QFileInfo> list = info.dir().entryInfoList(
-			PuMP_MainWindow::nameFilters, QDir::Files);
-		int index = list.indexOf(info);
+		QImage decoded = decode(info.filePath(), viewportSize, size, &token);
+		levels = createPyramid(decoded, &token);
+	}
 
-		hasNext = (index < (list.size() - 1));
-		hasPrevious = (index > 0);	
-		mirroredHorizontal = false;
-		mirroredVertical = false;
-		scaled = false;
-		zoom = DEFAULT_ZOOM;
-		
-		result = image;
+	// when stopped, the image shown before stays the current one and a
+	// prefetched image goes back into the cache
+	if(token.isCancelled())
+	{
+		if(prefetcher != NULL && !levels.isEmpty())
+			prefetcher->insert(info, levels, size);
+		cancelled = true;
+		processingFinished = true;
+		return;
 	}
-	else
+
+	pyramid = levels;
+	imageSize = size;
+	image = pyramid.isEmpty() ? QImage() : pyramid.first();
+	fullResolution = !image.isNull() && image.size() == imageSize;
+
+	if(!image.isNull())
 	{
-		QMatrix matrix;
-		if(!scaled)
-		{
-			double factor = zoom - DEFAULT_ZOOM;
-			if(factor < 0) factor /= (int)(MAX_ZOOM_STEPS / 2) + 1;
-			
-			matrix.rotate(rotation);
-			matrix.scale(1 + factor, 1 + factor);
-			result = image;
-			result = result.transformed(matrix, Qt::SmoothTransformation);
-			result = result.mirrored(mirroredHorizontal, mirroredVertical);
-		}
-		else
-		{
-			matrix.rotate(rotation);
-			result = image;
-			result = result.transformed(matrix, Qt::SmoothTransformation);
-			result = result.mirrored(mirroredHorizontal, mirroredVertical);
-			result = result.scaled(
-				((PuMP_ImageView *) parent())->size(),
-				Qt::KeepAspectRatio,
-				Qt::SmoothTransformation);
-			
-			double factor = ((double) result.width()) / image.width();
-			if(factor < 1) factor *= (int)(MAX_ZOOM_STEPS / 2) + 1;
+		// the direction of travel tells the prefetcher what comes next
+		int count;
+		int index = PuMP_MainWindow::siblingIndex->getRow(info, &count);
+		int before = previous.absolutePath() == info.absolutePath() ?
+			PuMP_MainWindow::siblingIndex->getRow(previous) : -1;
 
-			zoom = ((int) factor) + DEFAULT_ZOOM - 1;
-		}
+		backwards = mode == PuMP_ImageView::LoadPreviousImage ||
+			(before >= 0 && index >= 0 && index < before);
+		hasNext = (index >= 0 && index < (count - 1));
+		hasPrevious = (index > 0);	
 	}
 	
 	processingFinished = true;
-	if(result.isNull()) emit error(info.filePath());
-	else emit imageProcessed(result);
+	if(pyramid.isEmpty()) emit error(info.filePath());
+	else emit imageProcessed();
 }
 
 /**
@@ -304,7 +837,9 @@ void PuMP_ImageProcessor::process(int mode, const QFileInfo &info)
 {
 	if(isRunning() || mode == PuMP_ImageView::None) return;
 	
+	token.reset();
 	this->mode = mode;
+	shown = this->info;
 	if(mode == PuMP_ImageView::LoadImage)
 	{
 		if(!info.exists() || info.isDir())
@@ -377,6 +912,7 @@ int PuMP_ImageView::None = 0;
 int PuMP_ImageView::LoadImage = 1;
 int PuMP_ImageView::LoadNextImage = 2;
 int PuMP_ImageView::LoadPreviousImage = 4;
+int PuMP_ImageView::LoadFullResolution = 2048;
 int PuMP_ImageView::MirrorHorizontally = 8;
 int PuMP_ImageView::MirrorVertically = 16;
 int PuMP_ImageView::ResizeToOriginal = 32;
@@ -395,8 +931,12 @@ PuMP_ImageView::PuMP_ImageView(QWidget *parent)
 {
 	lastPos.setX(0);
 	lastPos.setY(0);
+	pendingMode = PuMP_ImageView::None;
 
-	display.setParent(this);
+	// the display only covers the viewport, the scroll-bars are set from
+	// the scaled size of the image, which may exceed what a widget can have
+	display.setParent(viewport());
+	display.show();
 	processor.setParent(this);
 	connect(
 		&processor,
@@ -405,9 +945,19 @@ PuMP_ImageView::PuMP_ImageView(QWidget *parent)
 		SLOT(on_error(const QString &)));
 	connect(
 		&processor,
-		SIGNAL(imageProcessed(const QImage &)),
+		SIGNAL(imageProcessed()),
+		this,
+		SLOT(on_imageProcessed()));
+	connect(
+		&processor,
+		SIGNAL(placeholderReady(const QImage &, const QSize &)),
+		this,
+		SLOT(on_placeholderReady(const QImage &, const QSize &)));
+	connect(
+		&processor,
+		SIGNAL(finished()),
 		this,
-		SLOT(on_imageProcessed(const QImage &)));
+		SLOT(on_processorFinished()));
 
 	horizontalScrollBar()->setMinimum(0);
 	verticalScrollBar()->setMinimum(0);
@@ -415,7 +965,6 @@ PuMP_ImageView::PuMP_ImageView(QWidget *parent)
 	setBackgroundRole(QPalette::Dark);
 	setCursor(Qt::OpenHandCursor);
 	setMouseTracking(false);
-	setWidget(&display);
 }
 
 /**
@@ -425,7 +974,7 @@ PuMP_ImageView::PuMP_ImageView(QWidget *parent)
  */
 void PuMP_ImageView::contextMenuEvent(QContextMenuEvent *event)
 {
-	if(!display.image.isNull())
+	if(!display.isNull())
 	{
 		QMenu menu(this);
 		menu.addAction(PuMP_MainWindow::mirrorHAction);
@@ -491,42 +1040,157 @@ void PuMP_ImageView::mouseReleaseEvent(QMouseEvent *event)
 }	
 
 /**
- * Function that moves the scroll-areas child-widget by the given coordinates.
+ * Function that moves the visible area of the image by the given
+ * coordinates.
  * @param	x	The horizontal movement.
  * @param	y	The vertical movement.
  */
 void PuMP_ImageView::moveBy(int x, int y)
 {
-	QSize s = widget()->size();
-	double pX = s.width() / horizontalScrollBar()->maximum();
-	double pY = s.height() / verticalScrollBar()->maximum();
 	int valX = horizontalScrollBar()->value();
 	int valY = verticalScrollBar()->value();
 
-	horizontalScrollBar()->setValue((int)(valX + x * pX));
-	verticalScrollBar()->setValue((int)(valY + y * pY));
+	horizontalScrollBar()->setValue(valX + x);
+	verticalScrollBar()->setValue(valY + y);
+}
+
+/**
+ * Overloaded function that is called when the view was resized. The display
+ * is kept as large as the viewport, a fitted image is fitted again.
+ * @param	event	The resize-event.
+ */
+void PuMP_ImageView::resizeEvent(QResizeEvent *event)
+{
+	QScrollArea::resizeEvent(event);
+	display.setGeometry(viewport()->rect());
+	if(processor.scaled) updateScale();
+	else updateScrollBars();
+}
+
+/**
+ * Overloaded function that is called when a scroll-bar moved. The display
+ * paints the newly visible part of the image.
+ * @param	dx	The horizontal movement, not needed.
+ * @param	dy	The vertical movement, not needed.
+ */
+void PuMP_ImageView::scrollContentsBy(int dx, int dy)
+{
+	Q_UNUSED(dx);
+	Q_UNUSED(dy);
+	display.setOffset(QPoint(
+		horizontalScrollBar()->value(),
+		verticalScrollBar()->value()));
+}
+
+/**
+ * Function that sets the scale of the display according to the zoom-step or
+ * fits the image into the view. The center of the visible area is kept.
+ */
+void PuMP_ImageView::updateScale()
+{
+	QSize size = display.getImageSize();
+	if(!size.isValid())
+	{
+		updateScrollBars();
+		return;
+	}
+
+	double scale;
+	if(processor.scaled)
+	{
+		QSize area = viewport()->size();
+		scale = qMin(
+			(double)area.width() / size.width(),
+			(double)area.height() / size.height());
+
+		double factor = scale;
+		if(factor < 1) factor *= (int)(MAX_ZOOM_STEPS / 2) + 1;
+		processor.zoom = ((int) factor) + DEFAULT_ZOOM - 1;
+	}
+	else
+	{
+		double factor = processor.zoom - DEFAULT_ZOOM;
+		if(factor < 0) factor /= (int)(MAX_ZOOM_STEPS / 2) + 1;
+		scale = 1 + factor;
+	}
+
+	QScrollBar *h = horizontalScrollBar();
+	QScrollBar *v = verticalScrollBar();
+	QSize area = viewport()->size();
+	QSize scaled = display.getScaledSize();
+	double cx = (h->value() + area.width() / 2.0) / qMax(1, scaled.width());
+	double cy = (v->value() + area.height() / 2.0) / qMax(1, scaled.height());
+
+	display.setScale(scale);
+	updateScrollBars();
+	scaled = display.getScaledSize();
+	h->setValue((int)(cx * scaled.width() - area.width() / 2.0));
+	v->setValue((int)(cy * scaled.height() - area.height() / 2.0));
+
+	// zoomed beyond the resolution the image was decoded with, the full one
+	// is decoded now
+	if(!processor.fullResolution && !processor.isRunning() &&
+		!processor.pyramid.isEmpty() &&
+		scale * processor.imageSize.width() >
+		processor.pyramid.first().width() + 1)
+		process(PuMP_ImageView::LoadFullResolution);
+}
+
+/**
+ * Function that sets the ranges of the scroll-bars from the scaled size of
+ * the image, in pixels of the screen.
+ */
+void PuMP_ImageView::updateScrollBars()
+{
+	QSize area = viewport()->size();
+	QSize scaled = display.getScaledSize();
+	QScrollBar *h = horizontalScrollBar();
+	QScrollBar *v = verticalScrollBar();
+
+	h->setPageStep(area.width());
+	h->setSingleStep(qMax(1, area.width() / 20));
+	h->setRange(0, qMax(0, scaled.width() - area.width()));
+	v->setPageStep(area.height());
+	v->setSingleStep(qMax(1, area.height() / 20));
+	v->setRange(0, qMax(0, scaled.height() - area.height()));
+
+	display.setOffset(QPoint(h->value(), v->value()));
 }
 
 /**
- * Function that returns the file-name associated with the view's image.
+ * Function that returns the file-name associated with the view's image. While
+ * a request is queued this is the image that will be shown next.
  * @return	The file-name associated with the view's image.
  */
 QString PuMP_ImageView::fileName() const
 {
-	return processor.info.fileName();
+	return getTarget().fileName();
 }
 
 /**
- * Function that returns the file-path associated with the view's image.
+ * Function that returns the file-path associated with the view's image. While
+ * a request is queued this is the image that will be shown next.
  * @return	The file-path associated with the view's image.
  */
 QString PuMP_ImageView::filePath() const
 {
-	return processor.info.filePath();
+	return getTarget().filePath();
+}
+
+/**
+ * Function that returns the image the view is going to show, that is the
+ * queued one if there is any and the processor's one otherwise.
+ * @return	A file-info object pointing on the latest requested image.
+ */
+QFileInfo PuMP_ImageView::getTarget() const
+{
+	if(pendingMode == PuMP_ImageView::LoadImage) return pendingInfo;
+	return processor.info;
 }
 
 /**
- * This is a wrapper for PuMP_ImageProcessor::getSuccessor().
+ * Function that returns the successor of the latest requested image, so
+ * that repeated steps skip the images that were never shown.
  * @param	previous	Flag indicating if the successor should be the next
  * 						or the previous entry.
  * @return	A file-info object pointing on the demanded successor, an empty
@@ -534,7 +1198,11 @@ QString PuMP_ImageView::filePath() const
  */
 QFileInfo PuMP_ImageView::getSuccessor(bool previous) const
 {
-	return processor.getSuccessor(previous);
+	QFileInfo target = getTarget();
+	if(PuMP_MainWindow::siblingIndex == NULL || target.fileName().isEmpty())
+		return QFileInfo();
+
+	return PuMP_MainWindow::siblingIndex->getSibling(target, previous ? -1 : 1);
 }
 
 /**
@@ -544,9 +1212,80 @@ QFileInfo PuMP_ImageView::getSuccessor(bool previous) const
  */
 void PuMP_ImageView::process(int mode, const QFileInfo &info)
 {
-	setActions(true);
+	// zooming, rotating and mirroring only change how the display paints,
+	// the image itself is resampled once it is saved
+	if(mode == PuMP_ImageView::ResizeToOriginal ||
+		mode == PuMP_ImageView::ResizeToFitted ||
+		mode == PuMP_ImageView::ZoomIn ||
+		mode == PuMP_ImageView::ZoomOut ||
+		mode == PuMP_ImageView::MirrorHorizontally ||
+		mode == PuMP_ImageView::MirrorVertically ||
+		mode == PuMP_ImageView::RotateClockWise ||
+		mode == PuMP_ImageView::RotateCounterClockWise)
+	{
+		// the processor never touches these, so they apply at once even
+		// while an image is being loaded
+		if(display.isNull()) return;
+
+		if(mode == PuMP_ImageView::ResizeToOriginal)
+			processor.zoom = DEFAULT_ZOOM;
+		else if(mode == PuMP_ImageView::ZoomIn &&
+			processor.zoom < MAX_ZOOM_STEPS) processor.zoom++;
+		else if(mode == PuMP_ImageView::ZoomOut && processor.zoom > 0)
+			processor.zoom--;
+		else if(mode == PuMP_ImageView::MirrorHorizontally)
+			processor.mirroredHorizontal = !processor.mirroredHorizontal;
+		else if(mode == PuMP_ImageView::MirrorVertically)
+			processor.mirroredVertical = !processor.mirroredVertical;
+		else if(mode == PuMP_ImageView::RotateClockWise)
+			processor.rotation = (processor.rotation + 90) % 360;
+		else if(mode == PuMP_ImageView::RotateCounterClockWise)
+			processor.rotation = (processor.rotation + 270) % 360;
+
+		if(mode == PuMP_ImageView::ResizeToOriginal ||
+			mode == PuMP_ImageView::ResizeToFitted ||
+			mode == PuMP_ImageView::ZoomIn ||
+			mode == PuMP_ImageView::ZoomOut)
+			processor.scaled = (mode == PuMP_ImageView::ResizeToFitted);
+
+		display.setTransform(
+			processor.rotation,
+			processor.mirroredHorizontal,
+			processor.mirroredVertical);
+		updateScale();
+		emit processingFinished();
+		return;
+	}
+
+	if(mode == PuMP_ImageView::LoadNextImage ||
+		mode == PuMP_ImageView::LoadPreviousImage)
+	{
+		bool previous = (mode == PuMP_ImageView::LoadPreviousImage);
+		QFileInfo next = getSuccessor(previous);
+		if(next.exists()) process(PuMP_ImageView::LoadImage, next);
+		return;
+	}
+
+	// while busy only the latest request is remembered, the ones in between
+	// would be shown for a moment at best
+	if(processor.isRunning())
+	{
+		if(mode == PuMP_ImageView::LoadImage)
+		{
+			pendingMode = mode;
+			pendingInfo = info;
+			processor.token.cancel();
+		}
+		else if(pendingMode == PuMP_ImageView::None) pendingMode = mode;
+		setActions();
+		return;
+	}
+
+	pendingMode = PuMP_ImageView::None;
 	backup = processor.info;
+	processor.viewportSize = viewport()->size();
 	processor.process(mode, info);
+	setActions();
 }
 
 /**
@@ -571,11 +1310,20 @@ void PuMP_ImageView::save(QString fpath)
 		if(fpath.isEmpty() || newExt.isEmpty()) return;
 	}
 	
-	QMatrix matrix;
-	matrix.rotate(processor.rotation);
-	QImage toSave = processor.image;
-	toSave = toSave.transformed(matrix, Qt::SmoothTransformation);
-	toSave = toSave.mirrored(
+	// the image may have been decoded at a lower resolution for the view
+	QImage full = processor.image;
+	if(!processor.fullResolution)
+	{
+		QSize size;
+		full = PuMP_ImageProcessor::decode(
+			processor.info.filePath(),
+			QSize(),
+			size);
+	}
+
+	QImage toSave = PuMP_Orientation::transform(
+		full,
+		processor.rotation,
 		processor.mirroredHorizontal,
 		processor.mirroredVertical);
 	
@@ -604,33 +1352,36 @@ void PuMP_ImageView::save(QString fpath)
 
 /**
  * Function that enables/disables all actions related to the image according
- * to the images properties.
+ * to the images properties. Stepping, zooming, rotating and mirroring stay
+ * available while an image is loaded, saving waits for it.
  * @param	disableAll	Flag to disable all actions. 
  */
 void PuMP_ImageView::setActions(bool disableAll)
 {
-	bool enable = processor.processingFinished;
-	PuMP_MainWindow::closeAction->setEnabled(!disableAll && enable);
-	PuMP_MainWindow::mirrorHAction->setEnabled(!disableAll && enable);
-	PuMP_MainWindow::mirrorVAction->setEnabled(!disableAll && enable);
+	bool enable = !disableAll && !display.isNull();
+	bool idle = enable && processor.processingFinished &&
+		!processor.isRunning() && pendingMode == PuMP_ImageView::None;
+	PuMP_MainWindow::closeAction->setEnabled(!disableAll);
+	PuMP_MainWindow::mirrorHAction->setEnabled(enable);
+	PuMP_MainWindow::mirrorVAction->setEnabled(enable);
 	PuMP_MainWindow::nextAction->setEnabled(
-		!disableAll && processor.hasNext && enable);
+		!disableAll && !getSuccessor().fileName().isEmpty());
 	PuMP_MainWindow::previousAction->setEnabled(
-		!disableAll && processor.hasPrevious && enable);
-	PuMP_MainWindow::rotateCWAction->setEnabled(!disableAll && enable);
-	PuMP_MainWindow::rotateCCWAction->setEnabled(!disableAll && enable);
-	PuMP_MainWindow::saveAction->setEnabled(!disableAll && enable &&
+		!disableAll && !getSuccessor(true).fileName().isEmpty());
+	PuMP_MainWindow::rotateCWAction->setEnabled(enable);
+	PuMP_MainWindow::rotateCCWAction->setEnabled(enable);
+	PuMP_MainWindow::saveAction->setEnabled(idle &&
 		(processor.mirroredHorizontal || processor.mirroredVertical ||
 		(processor.rotation != 0)));
-	PuMP_MainWindow::saveAsAction->setEnabled(!disableAll && enable);
+	PuMP_MainWindow::saveAsAction->setEnabled(idle);
 	PuMP_MainWindow::sizeOriginalAction->setEnabled(
-		!disableAll && processor.scaled && enable);
+		enable && processor.scaled);
 	PuMP_MainWindow::sizeFittedAction->setEnabled(
-		!disableAll && !processor.scaled && enable);
+		enable && !processor.scaled);
 	PuMP_MainWindow::zoomInAction->setEnabled(
-		!disableAll && (processor.zoom < MAX_ZOOM_STEPS) && enable);
+		enable && (processor.zoom < MAX_ZOOM_STEPS));
 	PuMP_MainWindow::zoomOutAction->setEnabled(
-		!disableAll && (processor.zoom > 0) && enable);
+		enable && (processor.zoom > 0));
 }
 
 /**
@@ -640,41 +1391,116 @@ void PuMP_ImageView::setActions(bool disableAll)
 void PuMP_ImageView::on_error(const QString &file)
 {
 	qDebug() << "Error processing" << file;
+	if(pendingMode != PuMP_ImageView::None) return;
 	emit error(this);
 }
 
 /**
- * Slot-function that is called when the image was processed.
- * @param	image	The processed image..
+ * Slot-function that is called when the image was processed. The display
+ * takes over the new pyramid and keeps the current scale. A result that was
+ * overtaken by a newer request is dropped.
  */
-void PuMP_ImageView::on_imageProcessed(const QImage &result)
+void PuMP_ImageView::on_imageProcessed()
 {
+	if(pendingMode != PuMP_ImageView::None) return;
+
+	if(processor.mode != PuMP_ImageView::LoadFullResolution)
+	{
+		processor.mirroredHorizontal = false;
+		processor.mirroredVertical = false;
+		processor.rotation = 0;
+		processor.zoom = DEFAULT_ZOOM;
+
+		// images larger than the view are fitted into it
+		QSize area = viewport()->size();
+		processor.scaled = processor.imageSize.width() > area.width() ||
+			processor.imageSize.height() > area.height();
+	}
+
 	emit processingFinished();
-	display.image = QPixmap::fromImage(result);
-	display.adjustSize();
-	display.update();
+	if(PuMP_MainWindow::prefetcher != NULL)
+		PuMP_MainWindow::prefetcher->prefetch(
+			processor.info,
+			processor.backwards,
+			viewport()->size());
+	display.setTransform(
+		processor.rotation,
+		processor.mirroredHorizontal,
+		processor.mirroredVertical);
+	display.setPyramid(processor.pyramid, processor.imageSize);
+	updateScale();
 }
 
 /**
- * Slot-function that stops the execution of the processor-thread if it is
- * currently running.
+ * Slot-function that is called when the cached thumbnail of a new image was
+ * found. It is shown stretched to the image's size until the image itself is
+ * decoded.
+ * @param	image		The thumbnail.
+ * @param	imageSize	The size of the image at full resolution.
  */
-void PuMP_ImageView::on_stop()
+void PuMP_ImageView::on_placeholderReady(
+	const QImage &image,
+	const QSize &imageSize)
 {
-	qDebug() << "stopped";
-	if(processor.isRunning())
+	if(!imageSize.isValid() || imageSize.isEmpty()) return;
+	if(pendingMode != PuMP_ImageView::None) return;
+
+	QList<QImage> pyramid;
+	pyramid.append(image);
+	QSize area = viewport()->size();
+	double scale = qMin(1.0, qMin(
+		(double)area.width() / imageSize.width(),
+		(double)area.height() / imageSize.height()));
+
+	display.setTransform(0, false, false);
+	display.setPyramid(pyramid, imageSize);
+	display.setScale(scale);
+	updateScrollBars();
+}
+
+/**
+ * Slot-function that is called when the processor-thread returned. A
+ * cancelled load left the image shown before in the processor, it replaces
+ * the placeholder of the abandoned one. The latest request that arrived
+ * meanwhile is started now.
+ */
+void PuMP_ImageView::on_processorFinished()
+{
+	// finished() is emitted shortly before the thread stops running
+	processor.wait();
+	if(processor.cancelled &&
+		processor.mode != PuMP_ImageView::LoadFullResolution)
 	{
-		processor.terminate();
-		processor.processingFinished = true;
-		processor.hasNext = false;
-		processor.hasPrevious = false;
-		processor.mirroredHorizontal = false;
-		processor.mirroredVertical = false;
-		processor.rotation = 0;
-		processor.scaled = false;
-		processor.zoom = DEFAULT_ZOOM;
 		processor.info = backup;
+		display.setTransform(
+			processor.rotation,
+			processor.mirroredHorizontal,
+			processor.mirroredVertical);
+		display.setPyramid(processor.pyramid, processor.imageSize);
+		updateScale();
+	}
+
+	if(pendingMode != PuMP_ImageView::None)
+	{
+		int mode = pendingMode;
+		QFileInfo info = pendingInfo;
+		pendingMode = PuMP_ImageView::None;
+		pendingInfo = QFileInfo();
+		process(mode, info);
 	}
+	emit processingFinished();
+}
+
+/**
+ * Slot-function that stops the execution of the processor-thread if it is
+ * currently running. The thread stops at its next checkpoint, then the image
+ * shown before is displayed again, see on_processorFinished().
+ */
+void PuMP_ImageView::on_stop()
+{
+	pendingMode = PuMP_ImageView::None;
+	pendingInfo = QFileInfo();
+	if(processor.isRunning()) processor.token.cancel();
 }
 
 /*****************************************************************************/
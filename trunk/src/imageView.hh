@@ -22,17 +22,35 @@
 #ifndef IMAGEVIEW_HH_
 #define IMAGEVIEW_HH_
 
+#include <QCache>
+#include <QDateTime>
 #include <QDialog>
 #include <QFileInfo>
 #include <QImage>
 #include <QLabel>
+#include <QList>
+#include <QMatrix>
+#include <QMutex>
 #include <QPixmap>
 #include <QPushButton>
 #include <QScrollArea>
 #include <QThread>
+#include <QWaitCondition>
+
+#include "cancelToken.hh"
 
 #define MAX_ZOOM_STEPS	8
 #define DEFAULT_ZOOM	4
+#define PYRAMID_MIN_SIZE	256
+#define TILE_SIZE		256
+#define TILE_CACHE		32
+#define TILE_SCREENS	4
+#define PREFETCH_AHEAD	2
+#define PREFETCH_BEHIND	1
+#define PREFETCH_MEMORY	256
+#define PREFETCH_POLL	50
+
+#define PUMP_IMAGEPREFETCHER_MEMORY	"PuMP_ImagePrefetcher::memory"
 
 /*****************************************************************************/
 
@@ -41,15 +59,89 @@ class PuMP_Display : public QWidget
 	Q_OBJECT
 	
 	protected:
+		bool mirroredHorizontal;
+		bool mirroredVertical;
+		int rotation;
+		double scale;
+
+		QPoint offset;
+		QSize imageSize;
+		QList<QImage> pyramid;
+		QCache<qint64, QPixmap> tiles;
+
+		int getLevel() const;
+		QMatrix getMatrix(int level) const;
+		QPixmap *getTile(int level, int x, int y);
 		void mousePressEvent(QMouseEvent *event);
 		void paintEvent(QPaintEvent *event);
+		void resizeEvent(QResizeEvent *event);
 	
 	public:
-		QPixmap image;
-
 		PuMP_Display(QWidget *parent = 0);
-		QSize sizeHint() const;
-	
+
+		QSize getImageSize() const;
+		double getScale() const;
+		QSize getScaledSize() const;
+		bool isNull() const;
+		void setOffset(const QPoint &offset);
+		void setPyramid(
+			const QList<QImage> &pyramid,
+			const QSize &imageSize);
+		void setScale(double scale);
+		void setTransform(
+			int rotation,
+			bool mirroredHorizontal,
+			bool mirroredVertical);
+};
+
+/*****************************************************************************/
+
+class PuMP_PrefetchedImage
+{
+	public:
+		QDateTime lastModified;
+		QSize imageSize;
+		QList<QImage> pyramid;
+};
+
+/*****************************************************************************/
+
+class PuMP_ImagePrefetcher : public QThread
+{
+	protected:
+		bool backwards;
+		bool moved;
+		bool shutdown;
+
+		QFileInfo center;
+		QSize fit;
+		QString current;
+		QList<QFileInfo> queue;
+		QCache<QString, PuMP_PrefetchedImage> cache;
+		PuMP_CancelToken token;
+		QMutex mutex;
+		QWaitCondition condition;
+
+		void insertLocked(
+			const QFileInfo &info,
+			const QList<QImage> &pyramid,
+			const QSize &imageSize);
+		void run();
+
+	public:
+		PuMP_ImagePrefetcher(QObject *parent = 0);
+		~PuMP_ImagePrefetcher();
+
+		void insert(
+			const QFileInfo &info,
+			const QList<QImage> &pyramid,
+			const QSize &imageSize);
+		void prefetch(const QFileInfo &info, bool backwards, const QSize &fit);
+		bool take(
+			const QFileInfo &info,
+			QList<QImage> &pyramid,
+			QSize &imageSize,
+			const PuMP_CancelToken *token = 0);
 };
 
 /*****************************************************************************/
@@ -64,8 +156,16 @@ class PuMP_ImageProcessor : public QThread
 	public:
 		QImage image;
 		QFileInfo info;
+		QFileInfo shown;
+		QSize imageSize;
+		QSize viewportSize;
+		QList<QImage> pyramid;
+		PuMP_CancelToken token;
 
 		int mode;
+		bool backwards;
+		bool cancelled;
+		bool fullResolution;
 		bool hasNext;
 		bool hasPrevious;
 		bool mirroredHorizontal;
@@ -76,13 +176,23 @@ class PuMP_ImageProcessor : public QThread
 		int zoom;
 
 		PuMP_ImageProcessor(QObject *parent = 0);
+		~PuMP_ImageProcessor();
 		
+		static QList<QImage> createPyramid(
+			const QImage &image,
+			const PuMP_CancelToken *token = 0);
+		static QImage decode(
+			const QString &path,
+			const QSize &fit,
+			QSize &imageSize,
+			const PuMP_CancelToken *token = 0);
 		QFileInfo getSuccessor(bool previous = false) const;
 		void process(int mode, const QFileInfo &info = QFileInfo());
 	
 	signals:
 		void error(const QString &file);
-		void imageProcessed(const QImage &result);
+		void imageProcessed();
+		void placeholderReady(const QImage &image, const QSize &imageSize);
 };
 
 /*****************************************************************************/
@@ -112,20 +222,28 @@ class PuMP_ImageView : public QScrollArea
 	Q_OBJECT
 
 	protected:
+		int pendingMode;
 		QFileInfo backup;
+		QFileInfo pendingInfo;
 		QPoint lastPos;
 
 		void contextMenuEvent(QContextMenuEvent *event);
+		QFileInfo getTarget() const;
 		void mouseMoveEvent(QMouseEvent *event);
 		void mousePressEvent(QMouseEvent *event);
 		void mouseReleaseEvent(QMouseEvent *event);		
 		void moveBy(int x, int y);
+		void resizeEvent(QResizeEvent *event);
+		void scrollContentsBy(int dx, int dy);
+		void updateScale();
+		void updateScrollBars();
 
 	public:
 		static int None;
 		static int LoadImage;
 		static int LoadNextImage;
 		static int LoadPreviousImage;
+		static int LoadFullResolution;
 		static int MirrorHorizontally;
 		static int MirrorVertically;
 		static int ResizeToOriginal;
@@ -148,7 +266,9 @@ class PuMP_ImageView : public QScrollArea
 
 	public slots:
 		void on_error(const QString &file);
-		void on_imageProcessed(const QImage &result);
+		void on_imageProcessed();
+		void on_placeholderReady(const QImage &image, const QSize &imageSize);
+		void on_processorFinished();
 		void on_stop();
 		
 	signals:
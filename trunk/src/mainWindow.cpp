@@ -25,7 +25,10 @@
 #include "exportDialog.hh"
 #include "imageView.hh"
 #include "mainWindow.hh"
+#include "overview.hh"
+#include "siblingIndex.hh"
 #include "tabView.hh"
+#include "thumbnailCache.hh"
 
 #include <assert.h>
 
@@ -69,9 +72,19 @@ QAction *PuMP_MainWindow::stopAction = NULL;
 QAction *PuMP_MainWindow::zoomInAction = NULL;
 QAction *PuMP_MainWindow::zoomOutAction = NULL;
 
+/** init static pointer to the decoder of the images next to the shown ones */
+PuMP_ImagePrefetcher *PuMP_MainWindow::prefetcher = NULL;
+
 /** init static pointer to settings */
 QSettings *PuMP_MainWindow::settings = NULL;
 
+/** init static pointer to the index of the images of directories */
+PuMP_SiblingIndex *PuMP_MainWindow::siblingIndex = NULL;
+
+/** init static pointer to the thumbnail-cache */
+QSlider *PuMP_MainWindow::thumbSizeSlider = NULL;
+PuMP_ThumbnailCache *PuMP_MainWindow::thumbnailCache = NULL;
+
 /** init static string-list */
 QStringList PuMP_MainWindow::nameFilters;
 QString PuMP_MainWindow::nameFilterString1;
@@ -92,6 +105,25 @@ PuMP_MainWindow::PuMP_MainWindow(QWidget *parent, Qt::WindowFlags flags)
 
 	// setup global actions
 	setupActions();
+
+	// persistent cache for the overview's thumbnails
+	PuMP_MainWindow::thumbnailCache = new PuMP_ThumbnailCache();
+
+	// sorted images of the directories in use, shared by all tabs
+	PuMP_MainWindow::siblingIndex = new PuMP_SiblingIndex();
+
+	// images decoded in advance, one memory-budget for all tabs
+	PuMP_MainWindow::prefetcher = new PuMP_ImagePrefetcher();
+
+	// slider for the overview's thumbnail-size, shown in the statusbar
+	PuMP_MainWindow::thumbSizeSlider = new QSlider(Qt::Horizontal, this);
+	PuMP_MainWindow::thumbSizeSlider->setRange(
+		THUMB_SIZE,
+		THUMB_SIZE << (THUMB_LEVELS - 1));
+	PuMP_MainWindow::thumbSizeSlider->setSingleStep(THUMB_SIZE / 4);
+	PuMP_MainWindow::thumbSizeSlider->setPageStep(THUMB_SIZE);
+	PuMP_MainWindow::thumbSizeSlider->setMaximumWidth(150);
+	PuMP_MainWindow::thumbSizeSlider->setToolTip("Thumbnail size");
 	
 	// central-widget and main layout
 	QWidget *cWidget = new QWidget(this);
@@ -110,6 +142,11 @@ PuMP_MainWindow::PuMP_MainWindow(QWidget *parent, Qt::WindowFlags flags)
 		SIGNAL(openImage(const QFileInfo &, bool)),
 		tabView,
 		SLOT(on_openImage(const QFileInfo &, bool)));
+	connect(
+		directoryView,
+		SIGNAL(historyChanged(const QStringList &)),
+		tabView,
+		SLOT(on_historyChanged(const QStringList &)));
 	connect(
 		tabView,
 		SIGNAL(updateStatusBar(int, const QString &)),
@@ -196,6 +233,7 @@ PuMP_MainWindow::PuMP_MainWindow(QWidget *parent, Qt::WindowFlags flags)
 	QStatusBar *bar = statusBar();
 	bar->addWidget(&progressBar);
 	bar->addWidget(&progressBarLabel);
+	bar->addPermanentWidget(PuMP_MainWindow::thumbSizeSlider);
 	QString text("");
 	on_statusBarUpdate(100, text);
 	
@@ -215,6 +253,14 @@ PuMP_MainWindow::~PuMP_MainWindow()
 	delete directoryView;
 	delete tabView;
 
+	// the prefetcher uses the sibling-index until it is stopped
+	delete PuMP_MainWindow::prefetcher;
+	PuMP_MainWindow::prefetcher = NULL;
+	delete PuMP_MainWindow::thumbnailCache;
+	PuMP_MainWindow::thumbnailCache = NULL;
+	delete PuMP_MainWindow::siblingIndex;
+	PuMP_MainWindow::siblingIndex = NULL;
+
 	delete PuMP_MainWindow::aboutAction;
 	delete PuMP_MainWindow::aboutQtAction;
 	delete PuMP_MainWindow::backwardAction;
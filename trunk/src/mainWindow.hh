@@ -26,6 +26,7 @@
 #include <QLabel>
 #include <QMainWindow>
 #include <QProgressBar>
+#include <QSlider>
 #include <QStringList>
 #include <QToolBar>
 
@@ -34,7 +35,10 @@
 /******************************************************************************/
 
 class PuMP_DirectoryView;
+class PuMP_ImagePrefetcher;
+class PuMP_SiblingIndex;
 class PuMP_TabView;
+class PuMP_ThumbnailCache;
 
 /******************************************************************************/
 
@@ -85,7 +89,11 @@ class PuMP_MainWindow : public QMainWindow, public PuMP_SettingsInterface
 		static QAction *zoomInAction;
 		static QAction *zoomOutAction;
 		
+		static PuMP_ImagePrefetcher *prefetcher;
 		static QSettings *settings;
+		static PuMP_SiblingIndex *siblingIndex;
+		static QSlider *thumbSizeSlider;
+		static PuMP_ThumbnailCache *thumbnailCache;
 		
 		static QStringList nameFilters;
 		static QString nameFilterString1;
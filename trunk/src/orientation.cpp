@@ -0,0 +1,330 @@
+/*
+ * Copyright 2007 Christoph Werle, Tobias Schlager
+ * 
+ * This file is part of "PuMP - Publish My Pictures".
+ *
+ * "Publish My Pictures" is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * "Publish My Pictures" is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with "Publish My Pictures"; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ */
+
+#include <string.h>
+
+#include <QList>
+#include <QMatrix>
+
+#include "orientation.hh"
+
+/*****************************************************************************/
+
+/**
+ * A pixel of a 24-bit image, copied as a whole.
+ */
+struct PuMP_Pixel24
+{
+	uchar c[3];
+};
+
+/**
+ * Function that fills the lines first to last of the target. The source-pixel
+ * of the first pixel of line y is found at origin + y * rowStep, the
+ * following ones columnStep bytes apart each.
+ */
+template<typename T>
+static void copyBand(
+	const uchar *origin,
+	int columnStep,
+	int rowStep,
+	uchar *bits,
+	int bytesPerLine,
+	int width,
+	int first,
+	int last)
+{
+	int x, y;
+	if(columnStep == (int)sizeof(T))
+	{
+		for(y = first; y < last; y++)
+			memcpy(bits + y * bytesPerLine, origin + y * rowStep,
+				width * sizeof(T));
+	}
+	else if(columnStep == -(int)sizeof(T))
+	{
+		for(y = first; y < last; y++)
+		{
+			const T *s = (const T *)(origin + y * rowStep);
+			T *d = (T *)(bits + y * bytesPerLine);
+			for(x = 0; x < width; x++) d[x] = s[-x];
+		}
+	}
+	else
+	{
+		// the columns of the source become lines of the target, the copy
+		// is done in blocks so the source-lines involved stay in the cache
+		int bx, by;
+		for(by = first; by < last; by += ORIENTATION_BLOCK_SIZE)
+		{
+			int bottom = qMin(by + ORIENTATION_BLOCK_SIZE, last);
+			for(bx = 0; bx < width; bx += ORIENTATION_BLOCK_SIZE)
+			{
+				int right = qMin(bx + ORIENTATION_BLOCK_SIZE, width);
+				for(y = by; y < bottom; y++)
+				{
+					const uchar *s = origin + y * rowStep + bx * columnStep;
+					T *d = (T *)(bits + y * bytesPerLine);
+					for(x = bx; x < right; x++, s += columnStep)
+						d[x] = *(const T *)s;
+				}
+			}
+		}
+	}
+}
+
+/*****************************************************************************/
+
+/**
+ * Constructor of class PuMP_OrientationBand, a thread that fills a band of
+ * lines of a rotated or mirrored image.
+ */
+PuMP_OrientationBand::PuMP_OrientationBand()
+	: QThread()
+{
+	bits = NULL;
+	bytesPerLine = 0;
+	columnStep = 0;
+	depth = 0;
+	first = 0;
+	last = 0;
+	origin = NULL;
+	rowStep = 0;
+	width = 0;
+}
+
+/**
+ * Function that sets the band to fill. It has to be called before the thread
+ * is started, the target mustn't be shared.
+ * @param	origin		The source-pixel of the top-left target-pixel.
+ * @param	columnStep	The distance in bytes between the source-pixels of
+ * 						two neighbouring pixels of a target-line.
+ * @param	rowStep		The distance in bytes between the source-pixels of
+ * 						two neighbouring target-lines.
+ * @param	target		The image to fill.
+ * @param	first		The first line of the band.
+ * @param	last		The line following the band.
+ */
+void PuMP_OrientationBand::setBand(
+	const uchar *origin,
+	int columnStep,
+	int rowStep,
+	QImage *target,
+	int first,
+	int last)
+{
+	this->origin = origin;
+	this->columnStep = columnStep;
+	this->rowStep = rowStep;
+	this->first = first;
+	this->last = last;
+
+	bits = target->bits();
+	bytesPerLine = target->bytesPerLine();
+	depth = target->depth();
+	width = target->width();
+}
+
+/**
+ * The overloaded main-function of this thread, which fills the band.
+ */
+void PuMP_OrientationBand::run()
+{
+	if(depth == 8) copyBand<quint8>(
+		origin, columnStep, rowStep, bits, bytesPerLine, width, first, last);
+	else if(depth == 16) copyBand<quint16>(
+		origin, columnStep, rowStep, bits, bytesPerLine, width, first, last);
+	else if(depth == 24) copyBand<PuMP_Pixel24>(
+		origin, columnStep, rowStep, bits, bytesPerLine, width, first, last);
+	else if(depth == 32) copyBand<quint32>(
+		origin, columnStep, rowStep, bits, bytesPerLine, width, first, last);
+}
+
+/*****************************************************************************/
+
+/**
+ * Function that checks whether an image can be transformed by copying whole
+ * pixels, i.e. whether it has 8, 16, 24 or 32 bits per pixel.
+ * @param	image	The image to check.
+ * @return	True if supported, false otherwise.
+ */
+bool PuMP_Orientation::isSupported(const QImage &image)
+{
+	int depth = image.depth();
+	return !image.isNull() &&
+		(depth == 8 || depth == 16 || depth == 24 || depth == 32);
+}
+
+/**
+ * Function that rotates an image by a multiple of 90 degrees and mirrors it
+ * afterwards, without any interpolation: every pixel is copied exactly once.
+ * Large images are split into bands of lines, which are filled in parallel.
+ * Images with less than 8 bits per pixel are handed to transformGeneric().
+ * @param	image				The image to transform.
+ * @param	rotation			The rotation clockwise in degrees, a multiple
+ * 								of 90.
+ * @param	mirroredHorizontal	True to mirror the rotated image
+ * 								horizontally.
+ * @param	mirroredVertical	True to mirror the rotated image vertically.
+ * @param	threads				The number of threads to use, 0 to use one
+ * 								per processor.
+ * @return	The transformed image.
+ */
+QImage PuMP_Orientation::transform(
+	const QImage &image,
+	int rotation,
+	bool mirroredHorizontal,
+	bool mirroredVertical,
+	int threads)
+{
+	rotation = ((rotation % 360) + 360) % 360;
+	if(rotation == 0 && !mirroredHorizontal && !mirroredVertical)
+		return image;
+	if(!isSupported(image)) return transformGeneric(
+		image,
+		rotation,
+		mirroredHorizontal,
+		mirroredVertical);
+
+	// the target-pixel (x', y') is taken from the source-pixel
+	// (x' * m11 + y' * m12 + x0, x' * m21 + y' * m22 + y0)
+	int w = image.width();
+	int h = image.height();
+	int m11 = 1, m12 = 0, m21 = 0, m22 = 1;
+	int x0 = 0, y0 = 0;
+	if(rotation == 90)
+	{
+		m11 = 0; m12 = 1; m21 = -1; m22 = 0;
+		y0 = h - 1;
+	}
+	else if(rotation == 180)
+	{
+		m11 = -1; m22 = -1;
+		x0 = w - 1;
+		y0 = h - 1;
+	}
+	else if(rotation == 270)
+	{
+		m11 = 0; m12 = -1; m21 = 1; m22 = 0;
+		x0 = w - 1;
+	}
+
+	QSize size = image.size();
+	if(rotation == 90 || rotation == 270) size.transpose();
+	if(mirroredHorizontal)
+	{
+		x0 += (size.width() - 1) * m11;
+		y0 += (size.width() - 1) * m21;
+		m11 = -m11;
+		m21 = -m21;
+	}
+	if(mirroredVertical)
+	{
+		x0 += (size.height() - 1) * m12;
+		y0 += (size.height() - 1) * m22;
+		m12 = -m12;
+		m22 = -m22;
+	}
+
+	QImage result(size, image.format());
+	if(result.isNull()) return QImage();
+	if(image.depth() == 8) result.setColorTable(image.colorTable());
+	if(size != image.size())
+	{
+		result.setDotsPerMeterX(image.dotsPerMeterY());
+		result.setDotsPerMeterY(image.dotsPerMeterX());
+	}
+	else
+	{
+		result.setDotsPerMeterX(image.dotsPerMeterX());
+		result.setDotsPerMeterY(image.dotsPerMeterY());
+	}
+
+	int pixel = image.depth() / 8;
+	int line = image.bytesPerLine();
+	const uchar *origin = image.bits() + y0 * line + x0 * pixel;
+	int columnStep = m11 * pixel + m21 * line;
+	int rowStep = m12 * pixel + m22 * line;
+
+	// small images aren't worth the threads, the bands are aligned to the
+	// blocks of the copy
+	if(threads <= 0) threads = QThread::idealThreadCount();
+	if(size.width() * size.height() < ORIENTATION_MIN_PIXELS) threads = 1;
+	int blocks = (size.height() + ORIENTATION_BLOCK_SIZE - 1) /
+		ORIENTATION_BLOCK_SIZE;
+	threads = qMax(1, qMin(threads, blocks));
+	int band = (blocks + threads - 1) / threads * ORIENTATION_BLOCK_SIZE;
+
+	QList<PuMP_OrientationBand *> bands;
+	int i;
+	for(i = 0; i < threads; i++)
+	{
+		PuMP_OrientationBand *b = new PuMP_OrientationBand();
+		b->setBand(
+			origin,
+			columnStep,
+			rowStep,
+			&result,
+			qMin(i * band, size.height()),
+			qMin((i + 1) * band, size.height()));
+		bands.append(b);
+	}
+
+	// the first band is filled by the calling thread itself
+	for(i = 1; i < bands.size(); i++) bands.at(i)->start();
+	bands.first()->run();
+	for(i = 0; i < bands.size(); i++)
+	{
+		bands.at(i)->wait();
+		delete bands.at(i);
+	}
+
+	return result;
+}
+
+/**
+ * Function that rotates and mirrors an image with QImage's general
+ * transformation, which works for all formats but is far slower.
+ * @param	image				The image to transform.
+ * @param	rotation			The rotation clockwise in degrees, a multiple
+ * 								of 90.
+ * @param	mirroredHorizontal	True to mirror the rotated image
+ * 								horizontally.
+ * @param	mirroredVertical	True to mirror the rotated image vertically.
+ * @return	The transformed image.
+ */
+QImage PuMP_Orientation::transformGeneric(
+	const QImage &image,
+	int rotation,
+	bool mirroredHorizontal,
+	bool mirroredVertical)
+{
+	QImage result = image;
+	if(rotation % 360 != 0)
+	{
+		QMatrix matrix;
+		matrix.rotate(rotation);
+		result = result.transformed(matrix);
+	}
+	return result.mirrored(mirroredHorizontal, mirroredVertical);
+}
+
+/*****************************************************************************/
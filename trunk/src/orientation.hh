@@ -0,0 +1,83 @@
+/*
+ * Copyright 2007 Christoph Werle, Tobias Schlager
+ * 
+ * This file is part of "PuMP - Publish My Pictures".
+ *
+ * "Publish My Pictures" is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * "Publish My Pictures" is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with "Publish My Pictures"; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ */
+
+#ifndef ORIENTATION_HH_
+#define ORIENTATION_HH_
+
+#include <QImage>
+#include <QThread>
+
+/******************************************************************************/
+
+#define ORIENTATION_BLOCK_SIZE		32
+#define ORIENTATION_MIN_PIXELS		(1024 * 1024)
+
+/******************************************************************************/
+
+class PuMP_OrientationBand : public QThread
+{
+	protected:
+		int bytesPerLine;
+		int columnStep;
+		int depth;
+		int first;
+		int last;
+		int rowStep;
+		int width;
+		const uchar *origin;
+		uchar *bits;
+
+	public:
+		PuMP_OrientationBand();
+
+		void setBand(
+			const uchar *origin,
+			int columnStep,
+			int rowStep,
+			QImage *target,
+			int first,
+			int last);
+
+		void run();
+};
+
+/******************************************************************************/
+
+class PuMP_Orientation
+{
+	public:
+		static bool isSupported(const QImage &image);
+		static QImage transform(
+			const QImage &image,
+			int rotation,
+			bool mirroredHorizontal,
+			bool mirroredVertical,
+			int threads = 0);
+		static QImage transformGeneric(
+			const QImage &image,
+			int rotation,
+			bool mirroredHorizontal,
+			bool mirroredVertical);
+};
+
+/******************************************************************************/
+
+#endif /*ORIENTATION_HH_*/
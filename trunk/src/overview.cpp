@@ -22,14 +22,198 @@
 #include <assert.h>
 
 #include <QContextMenuEvent>
+#include <QDateTime>
 #include <QDebug>
+#include <QDirIterator>
+#include <QFile>
 #include <QFileDialog>
+#include <QHash>
 #include <QMenu>
 #include <QMessageBox>
+#include <QMutexLocker>
+#include <QResizeEvent>
+#include <QTime>
+#include <QVector>
+#include <QtAlgorithms>
 
 #include "directoryView.hh"
+#include "downsampler.hh"
+#include "exif.hh"
 #include "mainWindow.hh"
 #include "overview.hh"
+#include "resampler.hh"
+#include "sharedThumbnails.hh"
+#include "siblingIndex.hh"
+#include "thumbnailCache.hh"
+
+/*****************************************************************************/
+
+/**
+ * Function that scales a size down to fit into a square, keeping its
+ * aspect-ratio. Sizes already fitting are returned unchanged.
+ * @param	size	The size to scale.
+ * @param	box		The width and height of the square.
+ * @return	The scaled size.
+ */
+static QSize fitSize(const QSize &size, int box)
+{
+	QSize result(box, box);
+	if(size.height() <= box && size.width() <= box) return size;
+
+	if(size.height() > size.width())
+		result.setWidth((box * 100 / size.height()) * size.width() / 100);
+	else result.setHeight((box * 100 / size.width()) * size.height() / 100);
+	return result.expandedTo(QSize(1, 1));
+}
+
+/*****************************************************************************/
+
+/**
+ * Constructor of class PuMP_OverviewAtlas. The atlas packs the thumbnails of
+ * the overview into a few large pixmaps, each divided into square slots.
+ */
+PuMP_OverviewAtlas::PuMP_OverviewAtlas()
+{
+	setSlotSize(THUMB_SIZE);
+}
+
+/**
+ * Function that reserves a free slot. A new page is created if all slots are
+ * in use.
+ * @return	The number of the reserved slot.
+ */
+int PuMP_OverviewAtlas::allocate()
+{
+	if(freeSlots.isEmpty())
+	{
+		QPixmap page(ATLAS_PAGE_SIZE, ATLAS_PAGE_SIZE);
+		page.fill(Qt::transparent);
+		pages.append(page);
+
+		int first = (pages.size() - 1) * perPage;
+		int i;
+		for(i = perPage - 1; i >= 0; i--) freeSlots.append(first + i);
+	}
+
+	return freeSlots.takeLast();
+}
+
+/**
+ * Function that releases all slots and pages.
+ */
+void PuMP_OverviewAtlas::clear()
+{
+	pages.clear();
+	freeSlots.clear();
+}
+
+/**
+ * Function that draws the content of a slot.
+ * @param	painter	The painter to draw with.
+ * @param	target	The area to draw the thumbnail into.
+ * @param	slot	The slot to draw.
+ * @param	size	The size of the thumbnail stored in the slot.
+ */
+void PuMP_OverviewAtlas::draw(
+	QPainter *painter,
+	const QRect &target,
+	int slot,
+	const QSize &size) const
+{
+	if(slot < 0 || slot / perPage >= pages.size()) return;
+
+	QRect source = slotRect(slot);
+	source.setSize(size);
+	painter->drawPixmap(target, pages.at(slot / perPage), source);
+}
+
+/**
+ * Function that returns the memory occupied by the pages of this atlas.
+ * @return	The size of all pages in bytes.
+ */
+qint64 PuMP_OverviewAtlas::getBytes() const
+{
+	return (qint64)pages.size() * ATLAS_PAGE_SIZE * ATLAS_PAGE_SIZE * 4;
+}
+
+/**
+ * Function that gives a slot back, so it can be reused.
+ * @param	slot	The slot to release.
+ */
+void PuMP_OverviewAtlas::release(int slot)
+{
+	if(slot >= 0) freeSlots.append(slot);
+}
+
+/**
+ * Function that returns the area of a slot within its page.
+ * @param	slot	The slot.
+ * @return	The area of the slot.
+ */
+QRect PuMP_OverviewAtlas::slotRect(int slot) const
+{
+	int i = slot % perPage;
+	return QRect(
+		(i % perLine) * slotSize,
+		(i / perLine) * slotSize,
+		slotSize,
+		slotSize);
+}
+
+/**
+ * Function that sets the size of the slots. All slots and pages are
+ * released.
+ * @param	size	The width and height of a slot.
+ */
+void PuMP_OverviewAtlas::setSlotSize(int size)
+{
+	clear();
+	slotSize = size;
+	perLine = ATLAS_PAGE_SIZE / size;
+	perPage = perLine * perLine;
+}
+
+/**
+ * Function that copies a thumbnail into a slot. The thumbnail is put into the
+ * top-left corner of the slot and must not be larger than it.
+ * @param	slot	The slot to fill.
+ * @param	image	The thumbnail.
+ */
+void PuMP_OverviewAtlas::store(int slot, const QImage &image)
+{
+	if(slot < 0 || slot / perPage >= pages.size()) return;
+
+	QRect target = slotRect(slot);
+	QPainter painter(&pages[slot / perPage]);
+	painter.setCompositionMode(QPainter::CompositionMode_Source);
+	painter.fillRect(target, QColor(Qt::transparent));
+	painter.drawImage(target.topLeft(), image);
+}
+
+/*****************************************************************************/
+
+/**
+ * Constructor of class PuMP_OverviewItem.
+ */
+PuMP_OverviewItem::PuMP_OverviewItem()
+{
+	loaded = false;
+	requested = false;
+	lastUsed = 0;
+	slot = -1;
+}
+
+/*****************************************************************************/
+
+/**
+ * Function that returns the memory occupied by the thumbnails of this
+ * snapshot. The items themselves are small in comparison and not counted.
+ * @return	The size of the thumbnails in bytes.
+ */
+qint64 PuMP_OverviewSnapshot::getBytes() const
+{
+	return atlas.getBytes();
+}
 
 /*****************************************************************************/
 
@@ -44,6 +228,15 @@ PuMP_OverviewModel::PuMP_OverviewModel(
 {
 	if(fontMetrics == NULL) this->fontMetrics = NULL;
 	else this->fontMetrics = new QFontMetrics(*fontMetrics);
+
+	clock = 0;
+	level = 0;
+	maxSlots = 0;
+	thumbSize = THUMB_SIZE;
+	usedSlots = 0;
+	visibleFirst = 0;
+	visibleLast = -1;
+	setBudget(OVERVIEW_MEMORY * 1024 * 1024);
 }
 
 /**
@@ -55,39 +248,58 @@ PuMP_OverviewModel::~PuMP_OverviewModel()
 }
 
 /**
- * Function that adds an image with its properties to this model. Duplicates
- * will be handled.
- * @param	pixmap	The (scaled) image.
- * @param	name	The image's file-name.
- * @param	props	The image's property-string (size and dimensions).
+ * Function that appends entries without thumbnails to this model. The
+ * thumbnails are set later on by setImages().
+ * @param	names	The file-names of the new entries.
  */
-void PuMP_OverviewModel::addImage(
-	const QPixmap &pixmap,
-	const QString &name,
-	const QString &props)
+void PuMP_OverviewModel::addEntries(const QStringList &names)
 {
-	if(getRowFromName(name) != -1) return;
-	int row = pixmaps.size();
+	if(names.isEmpty()) return;
+	int row = items.size();
 	
-	beginInsertRows(QModelIndex(), row, row);
-	pixmaps.insert(row, pixmap);
-	names.insert(row, name);
-	properties.insert(row, props);
+	beginInsertRows(QModelIndex(), row, row + names.size() - 1);
+	int i;
+	for(i = 0; i < names.size(); i++)
+	{
+		PuMP_OverviewItem item;
+		item.name = names.at(i);
+		item.text = elide(item.name);
+		items.append(item);
+		rows.insert(item.name, row + i);
+	}
 	endInsertRows();
 }
 
+/**
+ * Function that forgets which thumbnails were requested, e.g. because the
+ * loader discarded the jobs. They are requested again once visible.
+ */
+void PuMP_OverviewModel::cancelRequests()
+{
+	int i;
+	for(i = 0; i < items.size(); i++) items[i].requested = false;
+}
+
 /**
  * Function that clears all entries in the model.
  */
 void PuMP_OverviewModel::clear()
 {
-	QModelIndex dummy;
-	removeRows(0, rowCount(dummy), dummy);
+	if(items.isEmpty()) return;
+
+	beginRemoveRows(QModelIndex(), 0, items.size() - 1);
+	items.clear();
+	rows.clear();
+	lru.clear();
+	atlas.clear();
+	usedSlots = 0;
+	endRemoveRows();
 }
 
 /**
  * Function that returns the data of a certain item in the model. Usually only
- * called from the view displaying the model.
+ * called from the view displaying the model. The thumbnails themselves are
+ * drawn by PuMP_OverviewDelegate.
  * @param	index	The index of the demanded item.
  * @param	role	The role defining which data will be returned.
  * @return	The queried data or an empty QVariant if none is available.
@@ -96,30 +308,14 @@ QVariant PuMP_OverviewModel::data(
 	const QModelIndex &index,
 	int role) const
 {
-	if(!index.isValid()) return QVariant();
+	if(!index.isValid() || index.row() >= items.size()) return QVariant();
 	
-	if(role == Qt::DecorationRole) return QIcon(pixmaps.value(index.row()));
-	else if(role == Qt::DisplayRole)
-	{
-		QString display = names.value(index.row());
-		if(fontMetrics != NULL)
-		{
-			display = fontMetrics->elidedText(
-				display,
-				Qt::ElideRight,
-				(int)((ITEM_STRETCH - 1) * THUMB_SIZE) - ICON_PADDING);
-		}
-
-		QString props = properties.value(index.row());
-		if(!props.isEmpty()) display += "\n" + props;
-
-		return display;
-	}
+	if(role == Qt::DisplayRole) return items.at(index.row()).text;
 	else if(role == Qt::SizeHintRole)
 	{
 		QSize size(
-			(int)(ITEM_STRETCH * THUMB_SIZE),
-			THUMB_SIZE + ITEM_SPACING);
+			(int)(ITEM_STRETCH * thumbSize),
+			thumbSize + ITEM_SPACING);
 		return size;
 	}
 //	else if(role == Qt::ToolTipRole)
@@ -140,6 +336,60 @@ Qt::ItemFlags PuMP_OverviewModel::flags(const QModelIndex &index) const
 	return Qt::ItemIsSelectable | Qt::ItemIsEnabled;
 }
 
+/**
+ * Function that shortens a file-name to fit next to the thumbnail.
+ * @param	name	The file-name.
+ * @return	The elided file-name.
+ */
+QString PuMP_OverviewModel::elide(const QString &name) const
+{
+	if(fontMetrics == NULL) return name;
+	return fontMetrics->elidedText(
+		name,
+		Qt::ElideRight,
+		(int)((ITEM_STRETCH - 1) * thumbSize) - ICON_PADDING);
+}
+
+/**
+ * Function that releases the least recently used thumbnail to make room for
+ * another one. Visible thumbnails are skipped. The LRU-list keeps the
+ * slot along with the name, so the slot of an item that is gone is released
+ * as well.
+ * @return	True if a thumbnail was released, false otherwise.
+ */
+bool PuMP_OverviewModel::evict()
+{
+	QMap<quint32, QPair<QString, int> >::iterator i;
+	for(i = lru.begin(); i != lru.end(); ++i)
+	{
+		int row = rows.value(i.value().first, -1);
+		if(row < 0 || items.at(row).slot != i.value().second)
+		{
+			atlas.release(i.value().second);
+			usedSlots--;
+			lru.erase(i);
+			return true;
+		}
+
+		// visible thumbnails may have been painted before others that
+		// aren't visible any more
+		if(row >= visibleFirst && row <= visibleLast) continue;
+
+		release(items[row]);
+		return true;
+	}
+	return false;
+}
+
+/**
+ * Function that returns the atlas holding the thumbnails of this model.
+ * @return	The atlas.
+ */
+const PuMP_OverviewAtlas &PuMP_OverviewModel::getAtlas() const
+{
+	return atlas;
+}
+
 /**
  * Function that returns the file-name of the given item.
  * @param	index	The index of the item, the name will be fetched.
@@ -148,8 +398,37 @@ Qt::ItemFlags PuMP_OverviewModel::flags(const QModelIndex &index) const
  */
 QString PuMP_OverviewModel::getFileName(const QModelIndex &index) const
 {
-	if(!index.isValid()) return QString();
-	return names.value(index.row());
+	if(!index.isValid() || index.row() >= items.size()) return QString();
+	return items.at(index.row()).name;
+}
+
+/**
+ * Function that returns the level of the thumbnails held by this model. The
+ * thumbnails of level n fit into a square of THUMB_SIZE * 2^n pixels.
+ * @return	The level.
+ */
+int PuMP_OverviewModel::getLevel() const
+{
+	return level;
+}
+
+/**
+ * Function that returns the size the thumbnails are displayed with.
+ * @return	The width and height of the square thumbnails are fitted into.
+ */
+int PuMP_OverviewModel::getThumbSize() const
+{
+	return thumbSize;
+}
+
+/**
+ * Function that returns an item of this model.
+ * @param	row	The row of the item, must be valid.
+ * @return	The item.
+ */
+const PuMP_OverviewItem &PuMP_OverviewModel::getItem(int row) const
+{
+	return items.at(row);
 }
 
 /**
@@ -160,7 +439,39 @@ QString PuMP_OverviewModel::getFileName(const QModelIndex &index) const
  */
 int PuMP_OverviewModel::getRowFromName(const QString &name) const
 {
-	return names.indexOf(name);
+	return rows.value(name, -1);
+}
+
+/**
+ * Function that releases the thumbnail of an item whose file has changed.
+ * The item is marked as requested, so the caller has to queue it for
+ * thumbnailing.
+ * @param	row	The row of the item.
+ */
+void PuMP_OverviewModel::invalidate(int row)
+{
+	if(row < 0 || row >= items.size()) return;
+
+	PuMP_OverviewItem &item = items[row];
+	release(item);
+	item.loaded = false;
+	item.requested = true;
+	emit dataChanged(index(row), index(row));
+}
+
+/**
+ * Function that gives the thumbnail of an item back to the atlas. The item
+ * keeps its text, so only the thumbnail has to be created again.
+ * @param	item	The item.
+ */
+void PuMP_OverviewModel::release(PuMP_OverviewItem &item)
+{
+	if(item.slot < 0) return;
+
+	lru.remove(item.lastUsed);
+	atlas.release(item.slot);
+	item.slot = -1;
+	usedSlots--;
 }
 
 /**
@@ -177,23 +488,134 @@ bool PuMP_OverviewModel::removeRows(
 {
 	if(parent.isValid()) return false;
 	
-	if(row >= pixmaps.size() || row + count <= 0) return false;
+	if(row >= items.size() || row + count <= 0) return false;
 
 	int begin = qMax(0, row);
-	int end = qMin(row + count - 1, pixmaps.size() - 1);
+	int end = qMin(row + count - 1, items.size() - 1);
 
 	beginRemoveRows(parent, begin, end);
-	while(end >= begin)
+	int i;
+	for(i = begin; i <= end; i++)
 	{
-		pixmaps.removeAt(end);
-		names.removeAt(end);
-		properties.removeAt(end);
-		end--;
+		rows.remove(items.at(i).name);
+		release(items[i]);
 	}
+	items.erase(items.begin() + begin, items.begin() + end + 1);
+
+	// only the rows behind the removed ones have moved
+	for(i = begin; i < items.size(); i++) rows[items.at(i).name] = i;
 	endRemoveRows();
 	return true;
 }
 
+/**
+ * Function that brings the entries of this model into the given order.
+ * Entries not contained in the order are appended. Persistent indices (e.g.
+ * the selection of the view) are moved along.
+ * @param	order	The file-names in their new order.
+ */
+void PuMP_OverviewModel::reorder(const QStringList &order)
+{
+	emit layoutAboutToBeChanged();
+
+	QHash<QString, int> oldRows = rows;
+	QList<int> moved;
+	int i;
+	for(i = 0; i < order.size(); i++)
+	{
+		int row = oldRows.value(order.at(i), -1);
+		if(row < 0) continue;
+		moved.append(row);
+		oldRows.remove(order.at(i));
+	}
+	for(i = 0; i < items.size(); i++)
+		if(oldRows.contains(items.at(i).name)) moved.append(i);
+
+	QList<PuMP_OverviewItem> newItems;
+	QVector<int> newRows(moved.size());
+	for(i = 0; i < moved.size(); i++)
+	{
+		newItems.append(items.at(moved.at(i)));
+		newRows[moved.at(i)] = i;
+	}
+	items = newItems;
+	for(i = 0; i < items.size(); i++) rows.insert(items.at(i).name, i);
+
+	QModelIndexList from = persistentIndexList();
+	QModelIndexList to;
+	for(i = 0; i < from.size(); i++)
+		to.append(index(newRows.value(from.at(i).row())));
+	changePersistentIndexList(from, to);
+
+	emit layoutChanged();
+}
+
+/**
+ * Function that returns the rows in the given range whose thumbnails were
+ * released and have to be created again. The rows are marked, so they are
+ * only returned once.
+ * @param	first	The first row of the range.
+ * @param	last	The last row of the range.
+ * @return	The rows missing their thumbnails.
+ */
+QList<int> PuMP_OverviewModel::requestMissing(int first, int last)
+{
+	QList<int> missing;
+	int i;
+	for(i = qMax(0, first); i <= last && i < items.size(); i++)
+	{
+		PuMP_OverviewItem &item = items[i];
+		if(item.slot >= 0 || !item.loaded || item.requested) continue;
+
+		item.requested = true;
+		missing.append(i);
+	}
+	return missing;
+}
+
+/**
+ * Function that replaces the entries of this model by those of a snapshot
+ * taken by takeSnapshot(). If the level changed in the meantime, the
+ * thumbnails of the snapshot are dropped and requested again once visible.
+ * @param	snapshot	The snapshot.
+ */
+void PuMP_OverviewModel::restoreSnapshot(const PuMP_OverviewSnapshot &snapshot)
+{
+	clear();
+	if(snapshot.items.isEmpty()) return;
+
+	beginInsertRows(QModelIndex(), 0, snapshot.items.size() - 1);
+	items = snapshot.items;
+	int i;
+	for(i = 0; i < items.size(); i++) rows.insert(items.at(i).name, i);
+
+	if(snapshot.level == level)
+	{
+		atlas = snapshot.atlas;
+		lru = snapshot.lru;
+		clock = snapshot.clock;
+		usedSlots = snapshot.usedSlots;
+	}
+	else for(i = 0; i < items.size(); i++) items[i].slot = -1;
+
+	if(snapshot.thumbSize != thumbSize)
+	{
+		for(i = 0; i < items.size(); i++)
+		{
+			PuMP_OverviewItem &item = items[i];
+			QString properties = item.text.section('\n', 1);
+			item.text = elide(item.name);
+			if(!properties.isEmpty()) item.text += "\n" + properties;
+		}
+	}
+	endInsertRows();
+
+	// the budget may have been lowered since the snapshot was taken
+	visibleFirst = 0;
+	visibleLast = -1;
+	while(usedSlots > maxSlots && evict());
+}
+
 /**
  * Function that returns the number of items stored in this model.
  * @param	parent	Node needed.
@@ -202,7 +624,24 @@ bool PuMP_OverviewModel::removeRows(
 int PuMP_OverviewModel::rowCount(const QModelIndex &parent) const
 {
 	Q_UNUSED(parent);
-	return pixmaps.size();
+	return items.size();
+}
+
+/**
+ * Function that sets the memory thumbnails may occupy. Thumbnails above the
+ * budget are released, least recently used first.
+ * @param	bytes	The budget in bytes.
+ */
+void PuMP_OverviewModel::setBudget(qint64 bytes)
+{
+	budget = bytes;
+
+	// at least one page, which is more than a screen full
+	int slotSize = THUMB_SIZE << level;
+	qint64 page = ATLAS_PAGE_SIZE / slotSize;
+	page *= page;
+	maxSlots = (int)qMax(page, bytes / (slotSize * slotSize * 4));
+	while(usedSlots > maxSlots && evict());
 }
 
 /**
@@ -215,125 +654,1147 @@ void PuMP_OverviewModel::setFontMetrics(const QFontMetrics &fontMetrics)
 		this->fontMetrics = new QFontMetrics(fontMetrics);
 }
 
+/**
+ * Function that sets the thumbnails and the property-strings of several
+ * entries at once. The view is notified by a single signal covering all
+ * changed rows.
+ * @param	results	The thumbnails along with the file-names of their
+ * 					entries.
+ */
+void PuMP_OverviewModel::setImages(const QList<PuMP_OverviewResult> &results)
+{
+	int first = items.size();
+	int last = -1;
+
+	int i;
+	for(i = 0; i < results.size(); i++)
+	{
+		const PuMP_OverviewResult &result = results.at(i);
+		int row = getRowFromName(result.name);
+		if(row < 0) continue;
+
+		// thumbnails made for another level are requested again once the
+		// item becomes visible
+		int slotSize = THUMB_SIZE << level;
+		bool fits = result.level == level &&
+			result.image.width() <= slotSize &&
+			result.image.height() <= slotSize;
+
+		PuMP_OverviewItem &item = items[row];
+		item.text = item.text.section('\n', 0, 0);
+		if(!result.properties.isEmpty()) item.text += "\n" + result.properties;
+		item.loaded = true;
+		item.requested = false;
+
+		// beyond the budget only visible thumbnails are kept, the others
+		// are created again when they are scrolled into view
+		bool visible = row >= visibleFirst && row <= visibleLast;
+		if(!fits || (item.slot < 0 && usedSlots >= maxSlots &&
+			(!visible || !evict())))
+		{
+			first = qMin(first, row);
+			last = qMax(last, row);
+			continue;
+		}
+
+		if(item.slot < 0)
+		{
+			item.slot = atlas.allocate();
+			usedSlots++;
+		}
+		else lru.remove(item.lastUsed);
+		atlas.store(item.slot, result.image);
+		item.size = result.image.size();
+		item.lastUsed = ++clock;
+		lru.insert(item.lastUsed, qMakePair(item.name, item.slot));
+
+		first = qMin(first, row);
+		last = qMax(last, row);
+	}
+
+	if(last >= first) emit dataChanged(index(first), index(last));
+}
+
+/**
+ * Function that sets the size thumbnails are displayed with. They are taken
+ * from the smallest level at least as large. If the level changes, all
+ * thumbnails are released and have to be requested again.
+ * @param	size	The width and height of the square thumbnails are fitted
+ * 					into.
+ */
+void PuMP_OverviewModel::setThumbSize(int size)
+{
+	size = qBound(THUMB_SIZE, size, THUMB_SIZE << (THUMB_LEVELS - 1));
+	if(size == thumbSize) return;
+
+	emit layoutAboutToBeChanged();
+	thumbSize = size;
+
+	int newLevel = 0;
+	while((THUMB_SIZE << newLevel) < size) newLevel++;
+	bool released = newLevel != level;
+	if(released)
+	{
+		level = newLevel;
+		lru.clear();
+		atlas.setSlotSize(THUMB_SIZE << level);
+		usedSlots = 0;
+		setBudget(budget);
+	}
+
+	int i;
+	for(i = 0; i < items.size(); i++)
+	{
+		PuMP_OverviewItem &item = items[i];
+		if(released)
+		{
+			item.slot = -1;
+			item.requested = false;
+		}
+
+		QString properties = item.text.section('\n', 1);
+		item.text = elide(item.name);
+		if(!properties.isEmpty()) item.text += "\n" + properties;
+	}
+	emit layoutChanged();
+}
+
+/**
+ * Function that sets the range of rows currently visible. Their thumbnails
+ * won't be evicted.
+ * @param	first	The first visible row.
+ * @param	last	The last visible row.
+ */
+void PuMP_OverviewModel::setVisibleRange(int first, int last)
+{
+	visibleFirst = first;
+	visibleLast = last;
+}
+
+/**
+ * Function that moves all entries of this model along with their thumbnails
+ * into a snapshot. The model is empty afterwards.
+ * @param	snapshot	The snapshot to fill.
+ */
+void PuMP_OverviewModel::takeSnapshot(PuMP_OverviewSnapshot &snapshot)
+{
+	snapshot.clock = clock;
+	snapshot.level = level;
+	snapshot.thumbSize = thumbSize;
+	snapshot.usedSlots = usedSlots;
+	snapshot.atlas = atlas;
+	snapshot.items = items;
+	snapshot.lru = lru;
+
+	// jobs still queued for this model are discarded
+	int i;
+	for(i = 0; i < snapshot.items.size(); i++)
+		snapshot.items[i].requested = false;
+
+	clear();
+}
+
+/**
+ * Function that marks the thumbnail of an item as used, so it is evicted
+ * last. Called whenever the item is painted.
+ * @param	row	The row of the item.
+ */
+void PuMP_OverviewModel::touch(int row)
+{
+	if(row < 0 || row >= items.size()) return;
+
+	PuMP_OverviewItem &item = items[row];
+	if(item.slot < 0 || item.lastUsed == clock) return;
+
+	lru.remove(item.lastUsed);
+	item.lastUsed = ++clock;
+	lru.insert(item.lastUsed, qMakePair(item.name, item.slot));
+}
+
 /*****************************************************************************/
 
 /**
- * Constructor of class PuMP_OverviewLoader. The thread processes the given
- * images (represented by a QFileInfo-Object). It returns a scaled version of
- * the image along with its file-name and a property-string.
- * @param	parent	The parent-object of this thread.
+ * Constructor of class PuMP_OverviewDelegate. The delegate paints the items
+ * of the overview straight from the model's atlas.
+ * @param	model	The model whose items are painted.
+ * @param	parent	The parent of this delegate.
+ */
+PuMP_OverviewDelegate::PuMP_OverviewDelegate(
+	PuMP_OverviewModel *model,
+	QObject *parent)
+	: QAbstractItemDelegate(parent)
+{
+	this->model = model;
+}
+
+/**
+ * Function that paints an item: the thumbnail on the left, framed if it is
+ * smaller than the thumbnail-size, and the elided name with the properties
+ * right of it.
+ * @param	painter	The painter to draw with.
+ * @param	option	The style-options for the item.
+ * @param	index	The index of the item.
+ */
+void PuMP_OverviewDelegate::paint(
+	QPainter *painter,
+	const QStyleOptionViewItem &option,
+	const QModelIndex &index) const
+{
+	if(!index.isValid() || index.row() >= model->rowCount(QModelIndex()))
+		return;
+
+	model->touch(index.row());
+	const PuMP_OverviewItem &item = model->getItem(index.row());
+	bool selected = (option.state & QStyle::State_Selected) != 0;
+
+	painter->save();
+	if(selected) painter->fillRect(option.rect, option.palette.highlight());
+
+	int thumbSize = model->getThumbSize();
+	QRect frame(
+		option.rect.x(),
+		option.rect.y() + (option.rect.height() - thumbSize) / 2,
+		thumbSize,
+		thumbSize);
+	if(item.slot >= 0)
+	{
+		// thumbnails of the next larger level are scaled down to the size
+		// chosen by the user
+		QSize size = fitSize(item.size, thumbSize);
+		if(size.width() < thumbSize || size.height() < thumbSize)
+		{
+			painter->fillRect(frame, QBrush(Qt::white));
+			painter->setPen(QPen(QBrush(Qt::lightGray), 1));
+			painter->drawRect(frame.adjusted(0, 0, -1, -1));
+		}
+
+		if(size != item.size)
+			painter->setRenderHint(QPainter::SmoothPixmapTransform);
+		model->getAtlas().draw(
+			painter,
+			QRect(
+				frame.topLeft() + QPoint(
+					(thumbSize - size.width()) / 2,
+					(thumbSize - size.height()) / 2),
+				size),
+			item.slot,
+			item.size);
+	}
+
+	QRect text(
+		frame.right() + ICON_PADDING,
+		option.rect.y(),
+		option.rect.right() - frame.right() - ICON_PADDING,
+		option.rect.height());
+	painter->setFont(option.font);
+	if(selected)
+		painter->setPen(option.palette.color(QPalette::HighlightedText));
+	else painter->setPen(option.palette.color(QPalette::Text));
+	painter->drawText(text, Qt::AlignLeft | Qt::AlignVCenter, item.text);
+	painter->restore();
+}
+
+/**
+ * Function that returns the size of an item, which is the same for all.
+ * @param	option	Not needed.
+ * @param	index	Not needed.
+ * @return	The size of an item.
+ */
+QSize PuMP_OverviewDelegate::sizeHint(
+	const QStyleOptionViewItem &option,
+	const QModelIndex &index) const
+{
+	Q_UNUSED(option);
+	Q_UNUSED(index);
+	int thumbSize = model->getThumbSize();
+	return QSize((int)(ITEM_STRETCH * thumbSize), thumbSize + ITEM_SPACING);
+}
+
+/*****************************************************************************/
+
+/**
+ * Constructor of class PuMP_DirectoryReader. The reader lists a directory in
+ * its own thread and hands the entries out in batches, so large or slow
+ * directories don't block the GUI.
+ * @param	parent	The parent of this reader.
+ */
+PuMP_DirectoryReader::PuMP_DirectoryReader(QObject *parent)
+	: QThread(parent)
+{
+	generation = -1;
+	pending = false;
+	shutdown = false;
+	stopped = false;
+}
+
+/**
+ * Destructor of class PuMP_DirectoryReader, which stops the thread. It waits
+ * for the listing in progress to return.
+ */
+PuMP_DirectoryReader::~PuMP_DirectoryReader()
+{
+	mutex.lock();
+	shutdown = true;
+	stopped = true;
+	entries.clear();
+	condition.wakeAll();
+	mutex.unlock();
+	wait();
+}
+
+/**
+ * Function that returns whether a listing is still wanted, i.e. it wasn't
+ * stopped or replaced by another one. Called with the mutex locked.
+ * @param	generation	The generation of the listing.
+ * @return	True if the listing is still wanted, false otherwise.
+ */
+bool PuMP_DirectoryReader::isCurrent(int generation)
+{
+	return !stopped && generation == this->generation;
+}
+
+/**
+ * Function that returns the entries read since the last call.
+ * @return	The QFileInfo-Objects of the new entries.
+ */
+QList<QFileInfo> PuMP_DirectoryReader::takeEntries()
+{
+	QMutexLocker locker(&mutex);
+	QList<QFileInfo> result = entries;
+	entries.clear();
+	return result;
+}
+
+/**
+ * Function that starts to read the given directory. A listing still in
+ * progress isn't waited for, it returns with its next batch and is followed
+ * by this one.
+ * @param	path		The path of the directory to read.
+ * @param	nameFilters	The filters files must match, directories are always
+ * 						listed.
+ * @param	generation	The generation the signals of this listing carry.
+ */
+void PuMP_DirectoryReader::read(
+	const QString &path,
+	const QStringList &nameFilters,
+	int generation)
+{
+	QMutexLocker locker(&mutex);
+	this->path = path;
+	this->nameFilters = nameFilters;
+	this->generation = generation;
+	entries.clear();
+	pending = true;
+	stopped = false;
+	condition.wakeAll();
+
+	if(!isRunning()) start(QThread::LowPriority);
+}
+
+/**
+ * Function that lets a running listing return as soon as possible. Already
+ * read entries will be discarded.
+ */
+void PuMP_DirectoryReader::stop()
+{
+	QMutexLocker locker(&mutex);
+	stopped = true;
+	entries.clear();
+}
+
+/**
+ * Main-function of the reader, which lists the requested directories one
+ * after another.
+ */
+void PuMP_DirectoryReader::run()
+{
+	mutex.lock();
+	while(!shutdown)
+	{
+		if(!pending)
+		{
+			condition.wait(&mutex);
+			continue;
+		}
+
+		pending = false;
+		QString path = this->path;
+		QStringList nameFilters = this->nameFilters;
+		int generation = this->generation;
+		mutex.unlock();
+		list(path, nameFilters, generation);
+		mutex.lock();
+	}
+	mutex.unlock();
+}
+
+/**
+ * Function that lists a directory. The entries are collected and announced
+ * in batches of at most READER_BATCH_SIZE entries or READER_BATCH_TIME
+ * milliseconds, whatever comes first. Once the listing was stopped or
+ * replaced, it returns with the next batch.
+ * @param	path		The path of the directory to read.
+ * @param	nameFilters	The filters files must match.
+ * @param	generation	The generation the signals of this listing carry.
+ */
+void PuMP_DirectoryReader::list(
+	const QString &path,
+	const QStringList &nameFilters,
+	int generation)
+{
+	QDirIterator it(
+		path,
+		nameFilters,
+		QDir::Files | QDir::AllDirs | QDir::NoDotAndDotDot | QDir::Readable);
+
+	QList<QFileInfo> batch;
+	QTime time;
+	time.start();
+	while(it.hasNext())
+	{
+		it.next();
+
+		// the entry is stat'ed here rather than in the GUI-thread, the
+		// values are kept to detect changes on a later visit
+		QFileInfo info = it.fileInfo();
+		info.lastModified();
+		info.size();
+		batch.append(info);
+
+		if(batch.size() >= READER_BATCH_SIZE ||
+			time.elapsed() >= READER_BATCH_TIME)
+		{
+			mutex.lock();
+			if(!isCurrent(generation))
+			{
+				mutex.unlock();
+				return;
+			}
+			entries += batch;
+			mutex.unlock();
+
+			batch.clear();
+			time.restart();
+			emit entriesAvailable(generation);
+		}
+	}
+
+	mutex.lock();
+	if(!isCurrent(generation))
+	{
+		mutex.unlock();
+		return;
+	}
+	entries += batch;
+	mutex.unlock();
+
+	emit entriesAvailable(generation);
+	emit listingFinished(generation);
+}
+
+/*****************************************************************************/
+
+/**
+ * Constructor of class PuMP_OverviewJob.
+ */
+PuMP_OverviewJob::PuMP_OverviewJob()
+{
+	generation = 0;
+	index = 0;
+	level = 0;
+	idle = false;
+	subdirs = false;
+}
+
+/*****************************************************************************/
+
+/**
+ * Constructor of class PuMP_OverviewTimes, the time a worker spent in each
+ * stage of creating thumbnails, in milliseconds.
+ */
+PuMP_OverviewTimes::PuMP_OverviewTimes()
+{
+	lookup = 0;
+	decode = 0;
+	scale = 0;
+	store = 0;
+}
+
+/*****************************************************************************/
+
+/**
+ * Constructor of class PuMP_OverviewWorker. A worker repeatedly takes jobs
+ * from the loader's queue, creates the thumbnails and hands them back to the
+ * loader. It only returns from its main-function when the loader shuts down.
+ * @param	loader	The loader this worker takes its jobs from.
+ */
+PuMP_OverviewWorker::PuMP_OverviewWorker(PuMP_OverviewLoader *loader)
+	: QThread(loader)
+{
+	this->loader = loader;
+	lastLap = 0;
+}
+
+/**
+ * Function that aborts the job currently processed. The thumbnail-creation
+ * stops after the chunk of the file being decoded.
+ */
+void PuMP_OverviewWorker::cancel()
+{
+	token.cancel();
+}
+
+/**
+ * Function that creates the thumbnails of all levels from the best image
+ * available. Levels the image is too small for are left out, unless the
+ * image is the unscaled original, which then serves for all larger levels.
+ * @param	image		The largest thumbnail or the original image.
+ * @param	imageSize	The dimensions of the original image.
+ * @return	The thumbnails, smallest first.
+ */
+QList<QImage> PuMP_OverviewWorker::createLevels(
+	const QImage &image,
+	const QSize &imageSize)
+{
+	QList<QImage> levels;
+	int i;
+	for(i = 0; i < THUMB_LEVELS; i++)
+	{
+		QSize size = fitSize(imageSize, THUMB_SIZE << i);
+		if(size.width() > image.width() || size.height() > image.height())
+			break;
+
+		if(size == image.size()) levels.append(image);
+		else levels.append(PuMP_Resampler::scale(
+			image,
+			size,
+			PuMP_Resampler::Area,
+			1));
+		if(size == imageSize) break;
+	}
+	return levels;
+}
+
+/**
+ * Function that processes a job of the background-indexer. Directories are
+ * listed, the thumbnails of files are created and put into the
+ * thumbnail-cache, unless they are cached already.
+ * @param	job		The job.
+ * @param	found	Returns the entries of a listed directory, either its
+ * 					images or its subdirectories.
+ * @return	True if the job is done, false if it was cancelled.
+ */
+bool PuMP_OverviewWorker::indexEntry(
+	const PuMP_OverviewJob &job,
+	QList<QFileInfo> &found)
+{
+	if(job.info.isDir())
+	{
+		QDir dir(job.info.filePath());
+		if(job.subdirs) found = dir.entryInfoList(
+			QDir::AllDirs | QDir::NoDotAndDotDot | QDir::Readable,
+			QDir::Name);
+		else found = dir.entryInfoList(
+			PuMP_MainWindow::nameFilters,
+			QDir::Files | QDir::Readable,
+			QDir::Name);
+		return !token.isCancelled();
+	}
+
+	QImage result;
+	QString properties;
+	createThumbnail(job.info, 0, result, properties);
+	return !token.isCancelled();
+}
+
+/**
+ * Function that adds the time since the last lap to a stage of the
+ * thumbnail-creation. The laps are taken from a single clock, so the
+ * rounding to milliseconds doesn't add up over the stages.
+ * @param	stage	The stage that just ended.
+ */
+void PuMP_OverviewWorker::lap(int &stage)
+{
+	int now = clock.elapsed();
+	stage += now - lastLap;
+	lastLap = now;
+}
+
+/**
+ * Function that picks the thumbnail of a level from the given ones.
+ * @param	levels		The thumbnails, smallest first.
+ * @param	imageSize	The dimensions of the original image.
+ * @param	level		The demanded level.
+ * @return	The thumbnail or a null-image if the level is missing.
+ */
+QImage PuMP_OverviewWorker::pickLevel(
+	const QList<QImage> &levels,
+	const QSize &imageSize,
+	int level)
+{
+	if(levels.isEmpty()) return QImage();
+	if(level < levels.size()) return levels.at(level);
+
+	// the unscaled original fits into every larger level
+	if(levels.last().size() == imageSize) return levels.last();
+	return QImage();
+}
+
+/**
+ * Function that creates the thumbnail of the given file along with its
+ * property-string. Thumbnails of all levels are created at once and cached,
+ * so switching the thumbnail-size doesn't need to decode the image again.
+ * @param	info		The file to create the thumbnail for.
+ * @param	level		The level of the thumbnail to return.
+ * @param	result		Returns the thumbnail.
+ * @param	properties	Returns the property-string (size and dimensions).
+ * @return	True on success, false if the file couldn't be loaded.
+ */
+bool PuMP_OverviewWorker::createThumbnail(
+	const QFileInfo &info,
+	int level,
+	QImage &result,
+	QString &properties)
+{
+	result = QImage();
+	properties = "";
+	times = PuMP_OverviewTimes();
+	clock.start();
+	lastLap = 0;
+	
+	if(!info.isDir())
+	{
+		QSize rSize;
+		QList<QImage> levels;
+		PuMP_ThumbnailCache *cache = PuMP_MainWindow::thumbnailCache;
+		if(cache != NULL && cache->lookup(info, levels, rSize))
+			result = pickLevel(levels, rSize, level);
+
+		// thumbnails other applications left in the shared directories
+		QImage shared;
+		if(result.isNull() &&
+			PuMP_SharedThumbnails::lookup(info, shared, rSize))
+		{
+			if(!rSize.isValid())
+			{
+				reader.setFileName(info.filePath());
+				rSize = reader.size();
+				reader.setDevice(NULL);
+			}
+			lap(times.lookup);
+
+			if(rSize.isValid())
+			{
+				levels = createLevels(shared, rSize);
+				result = pickLevel(levels, rSize, level);
+			}
+			lap(times.scale);
+			if(!result.isNull() && cache != NULL)
+				cache->insert(info, levels, rSize);
+			lap(times.store);
+		}
+		else lap(times.lookup);
+
+		if(result.isNull())
+		{
+			PuMP_CancellableFile file(info.filePath(), &token);
+			if(!file.open(QIODevice::ReadOnly)) return false;
+
+			QImage embedded;
+			PuMP_Exif::readThumbnail(&file, embedded);
+			file.seek(0);
+
+			reader.setDevice(&file);
+			reader.setScaledSize(QSize());
+
+			rSize = reader.size();
+			QSize size = fitSize(rSize, THUMB_SIZE << (THUMB_LEVELS - 1));
+			bool scale = size != rSize;
+
+			// the embedded thumbnail is used if it is large enough for the
+			// demanded level and has the aspect-ratio of the image, some
+			// cameras add black bars
+			qint64 aspect = (qint64)embedded.width() * rSize.height() -
+				(qint64)embedded.height() * rSize.width();
+			lap(times.decode);
+			if(scale && !embedded.isNull() &&
+				qAbs(aspect) * 50 <= (qint64)embedded.width() * rSize.height())
+			{
+				levels = createLevels(embedded, rSize);
+				result = pickLevel(levels, rSize, level);
+			}
+			lap(times.scale);
+
+			// PNG and BMP can't be scaled while decoding, they are
+			// downsampled line by line instead of decoded as a whole
+			QImage image;
+			if(result.isNull() && scale && file.seek(0))
+				PuMP_ScanlineReader::read(&file, size, image, &token);
+
+			if(result.isNull() && image.isNull() && !token.isCancelled() &&
+				file.seek(0))
+			{
+				reader.setDevice(&file);
+				if(scale) reader.setScaledSize(size);
+
+				// a cancelled read may return a partially decoded image
+				if(reader.canRead()) image = reader.read();
+			}
+
+			reader.setDevice(NULL);
+			lap(times.decode);
+			if(token.isCancelled()) return false;
+
+			if(result.isNull())
+			{
+				if(image.isNull()) return false;
+				levels = createLevels(image, rSize);
+				result = pickLevel(levels, rSize, level);
+			}
+			lap(times.scale);
+
+			if(cache != NULL) cache->insert(info, levels, rSize);
+
+			// the original itself is never stored as thumbnail
+			if(loader->getWriteShared())
+			{
+				int i;
+				for(i = 1; i < levels.size(); i++)
+					if(levels.at(i).size() != rSize)
+						PuMP_SharedThumbnails::store(
+							info,
+							levels.at(i),
+							rSize);
+			}
+			lap(times.store);
+		}
+
+		properties += QString::number(rSize.width())
+			+ "x"
+			+ QString::number(rSize.height())
+			+ "\n"
+			+ QString::number(((double) info.size()) / 1024, 'f', 1)
+			+ " KB";
+	}
+	else result.load(":/folder64.png");
+	
+	if(result.isNull()) return false;
+	
+	return true;
+}
+
+/**
+ * The overloaded main-function of this thread, which processes jobs until
+ * the loader shuts down.
+ */
+void PuMP_OverviewWorker::run()
+{
+	PuMP_OverviewJob job;
+	while(loader->takeJob(job, &token))
+	{
+		if(job.idle)
+		{
+			QList<QFileInfo> found;
+			setPriority(QThread::IdlePriority);
+			bool done = indexEntry(job, found);
+			setPriority(QThread::LowPriority);
+
+			loader->finishIdleJob(job, done, found);
+			continue;
+		}
+
+		QImage result;
+		QString properties;
+		if(!createThumbnail(job.info, job.level, result, properties))
+			result = QImage();
+
+		loader->addTimes(times);
+		loader->finishJob(job, result, properties);
+	}
+}
+
+/*****************************************************************************/
+
+/**
+ * Constructor of class PuMP_OverviewLoader. The loader owns a pool of worker
+ * threads that process the given images (represented by QFileInfo-Objects)
+ * in parallel. Every job returns a scaled version of the image along with
+ * its file-name, a property-string and its index in the processed list.
+ * @param	parent	The parent-object of this loader.
+ */
+PuMP_OverviewLoader::PuMP_OverviewLoader(QObject *parent) : QObject(parent)
+{
+	active = 0;
+	generation = 0;
+	focusFirst = 0;
+	focusLast = 0;
+	level = 0;
+	idleLeft = 0;
+	shutdown = false;
+	idleToken = NULL;
+	idleTime.start();
+
+	int threads = PuMP_MainWindow::settings->value(
+		PUMP_OVERVIEWLOADER_THREADS,
+		QThread::idealThreadCount()).toInt();
+	if(threads < 1) threads = 1;
+	writeShared = PuMP_MainWindow::settings->value(
+		PUMP_OVERVIEWLOADER_WRITESHARED,
+		false).toBool();
+
+	int i;
+	for(i = 0; i < threads; i++)
+	{
+		PuMP_OverviewWorker *worker = new PuMP_OverviewWorker(this);
+		workers.append(worker);
+		worker->start(QThread::LowPriority);
+	}
+}
+
+/**
+ * Destructor of class PuMP_OverviewLoader that stops all workers.
+ */
+PuMP_OverviewLoader::~PuMP_OverviewLoader()
+{
+	wait();
+}
+
+/**
+ * Function that is called by the workers to add the time they spent in the
+ * stages of a job, see takeTimes().
+ * @param	times	The times of the job.
+ */
+void PuMP_OverviewLoader::addTimes(const PuMP_OverviewTimes &times)
+{
+	QMutexLocker locker(&mutex);
+	this->times.lookup += times.lookup;
+	this->times.decode += times.decode;
+	this->times.scale += times.scale;
+	this->times.store += times.store;
+}
+
+/**
+ * Function that is called by the workers to hand back a processed job.
+ * Results of a stopped generation are discarded.
+ * @param	job			The processed job.
+ * @param	image		The thumbnail, a null image if processing failed.
+ * @param	properties	The property-string of the image.
+ */
+void PuMP_OverviewLoader::finishJob(
+	const PuMP_OverviewJob &job,
+	const QImage &image,
+	const QString &properties)
+{
+	mutex.lock();
+	bool stale = (job.generation != generation);
+	mutex.unlock();
+
+	if(!stale && image.isNull())
+		emit imageIsNull(job.generation, job.index, job.info.fileName());
+	else if(!stale) emit processedImage(
+		job.generation,
+		job.index,
+		job.level,
+		job.info.fileName(),
+		properties,
+		image);
+
+	// the job is only done after its result was emitted, so the finished
+	// signal is never delivered before the results of the other workers;
+	// jobs of a stopped generation were already uncounted on restart
+	mutex.lock();
+	bool done = false;
+	if(job.generation == generation)
+	{
+		active--;
+		done = (active == 0 && jobs.isEmpty());
+	}
+	mutex.unlock();
+
+	if(done) emit finished(job.generation);
+}
+
+/**
+ * Function that is called by the workers to hand back a processed job of the
+ * background-indexer. The entries found in a listed directory are indexed
+ * next, up to INDEXER_MAX_FILES files per run. A cancelled job is queued
+ * again.
+ * @param	job		The processed job.
+ * @param	done	False if the job was cancelled.
+ * @param	found	The entries found in a listed directory.
+ */
+void PuMP_OverviewLoader::finishIdleJob(
+	const PuMP_OverviewJob &job,
+	bool done,
+	const QList<QFileInfo> &found)
+{
+	QMutexLocker locker(&mutex);
+	idleToken = NULL;
+	idleTime.restart();
+	if(job.generation != generation) return;
+
+	if(!done)
+	{
+		idleJobs.prepend(job);
+		return;
+	}
+
+	// the entries of a directory are indexed before the next directory, so
+	// directories become warm one after the other
+	int i;
+	for(i = found.size() - 1; i >= 0; i--)
+	{
+		if(!found.at(i).isDir())
+		{
+			if(idleLeft <= 0) continue;
+			idleLeft--;
+		}
+
+		PuMP_OverviewJob entry;
+		entry.generation = generation;
+		entry.idle = true;
+		entry.info = found.at(i);
+		idleJobs.prepend(entry);
+	}
+	condition.wakeAll();
+}
+
+/**
+ * Function that returns whether the thumbnails created by the workers are
+ * written to the shared thumbnail-directories of the freedesktop.org
+ * specification as well.
+ * @return	True if they are written, false otherwise.
+ */
+bool PuMP_OverviewLoader::getWriteShared() const
+{
+	return writeShared;
+}
+
+/**
+ * Function that queues directories for the background-indexer. Its jobs are
+ * only taken when there is nothing else to do, by one worker at a time with
+ * the lowest priority and a pause of INDEXER_PAUSE milliseconds in between.
+ * It gives way to new jobs immediately. The queue is discarded on restart.
+ * @param	dirs	The directories whose images are indexed.
+ * @param	subdirs	If true, the subdirectories of the given directories are
+ * 					indexed instead.
+ */
+void PuMP_OverviewLoader::index(const QList<QFileInfo> &dirs, bool subdirs)
+{
+	QMutexLocker locker(&mutex);
+	if(idleJobs.isEmpty() && idleToken == NULL) idleLeft = INDEXER_MAX_FILES;
+
+	int i;
+	for(i = 0; i < dirs.size(); i++)
+	{
+		PuMP_OverviewJob job;
+		job.generation = generation;
+		job.idle = true;
+		job.subdirs = subdirs;
+		job.info = dirs.at(i);
+		idleJobs.append(job);
+	}
+	condition.wakeAll();
+}
+
+/**
+ * Function that returns whether there are jobs of the current generation
+ * queued or in progress.
+ * @return	True if the loader is busy, false otherwise.
+ */
+bool PuMP_OverviewLoader::isRunning()
+{
+	QMutexLocker locker(&mutex);
+	return (active > 0 || !jobs.isEmpty());
+}
+
+/**
+ * Function that can be called from the outside of this class to let the
+ * workers process the given images. The jobs are added to the current
+ * generation.
+ * @param	infos	The QFileInfo-Objects representing the images to process.
+ * @param	first	The index of the first image in the directory-listing.
+ */
+void PuMP_OverviewLoader::processImages(
+	const QList<QFileInfo> &infos,
+	int first)
+{
+	QMutexLocker locker(&mutex);
+
+	int i;
+	for(i = 0; i < infos.size(); i++)
+	{
+		PuMP_OverviewJob job;
+		job.generation = generation;
+		job.index = first + i;
+		job.info = infos.at(i);
+		jobs.insertMulti(job.index, job);
+	}
+
+	// the background-indexer gives way to the new jobs
+	if(idleToken != NULL) idleToken->cancel();
+	condition.wakeAll();
+}
+
+/**
+ * Function that assigns new indices to all queued jobs after the
+ * directory-listing was reordered.
+ * @param	order	The reordered directory-listing.
+ */
+void PuMP_OverviewLoader::reorder(const QList<QFileInfo> &order)
+{
+	QMutexLocker locker(&mutex);
+
+	QHash<QString, int> indices;
+	int i;
+	for(i = 0; i < order.size(); i++)
+		indices.insert(order.at(i).fileName(), i);
+
+	QMap<int, PuMP_OverviewJob> reordered;
+	QMap<int, PuMP_OverviewJob>::iterator it;
+	for(it = jobs.begin(); it != jobs.end(); it++)
+	{
+		PuMP_OverviewJob job = it.value();
+		job.index = indices.value(job.info.fileName(), job.index);
+		reordered.insertMulti(job.index, job);
+	}
+	jobs = reordered;
+}
+
+/**
+ * Function that discards all queued jobs and starts a new generation. The
+ * results of jobs still in progress will be dropped.
+ * @return	The generation new jobs will be tagged with.
+ */
+int PuMP_OverviewLoader::restart()
+{
+	QMutexLocker locker(&mutex);
+	generation++;
+	active = 0;
+	jobs.clear();
+	idleJobs.clear();
+	cancelWorkers();
+	return generation;
+}
+
+/**
+ * Function to discard all queued jobs and mark the results of the jobs in
+ * progress as stale. Needed for a stop-function.
+ */
+void PuMP_OverviewLoader::setKilled()
+{
+	restart();
+}
+
+/**
+ * Function that sets the range of indices currently visible to the user.
+ * Jobs are handed out by their distance to this range, so the visible
+ * thumbnails are created first.
+ * @param	first	The first visible index.
+ * @param	last	The last visible index.
+ */
+void PuMP_OverviewLoader::setFocus(int first, int last)
+{
+	QMutexLocker locker(&mutex);
+	focusFirst = first;
+	focusLast = qMax(first, last);
+}
+
+/**
+ * Function that sets the level of the thumbnails created from now on.
+ * @param	level	The level, see PuMP_OverviewModel::getLevel().
  */
-PuMP_OverviewLoader::PuMP_OverviewLoader(QObject *parent) : QThread(parent)
+void PuMP_OverviewLoader::setLevel(int level)
 {
-	killed = false;
-	size.setWidth(THUMB_SIZE);
-	size.setHeight(THUMB_SIZE);
+	QMutexLocker locker(&mutex);
+	this->level = level;
 }
 
 /**
- * The overloaded main-function of this thread, which processes the given
- * image.
+ * Function that is called by the workers to obtain their next job. It
+ * blocks until a job is available and returns the queued job closest to
+ * the visible range. Jobs of the background-indexer are handed out if no
+ * other job is queued.
+ * @param	job		Returns the job to process.
+ * @param	token	The worker's cancel-token, reset for the new job.
+ * @return	True if a job was returned, false if the loader shuts down.
  */
-void PuMP_OverviewLoader::run()
+bool PuMP_OverviewLoader::takeJob(
+	PuMP_OverviewJob &job,
+	PuMP_CancelToken *token)
 {
-	killed = false;
-	
-	rProperties = "";
-	rName = "";
-	
-	if(!info.isDir())
+	QMutexLocker locker(&mutex);
+	while(jobs.isEmpty())
 	{
-		rSize = reader.size();
-		rProperties += QString::number(rSize.width())
-			+ "x"
-			+ QString::number(rSize.height())
-			+ "\n"
-			+ QString::number(((double) info.size()) / 1024, 'f', 1)
-			+ " KB";
+		if(shutdown) return false;
 
-		if(rSize.height() > size.height() || rSize.width() > size.width())
+		// jobs of the background-indexer are only taken when idle
+		if(idleJobs.isEmpty() || idleToken != NULL) condition.wait(&mutex);
+		else if(idleTime.elapsed() < INDEXER_PAUSE) condition.wait(
+			&mutex,
+			INDEXER_PAUSE - idleTime.elapsed());
+		else
 		{
-			if(rSize.height() > rSize.width())
-				size.setWidth(
-					(THUMB_SIZE * 100 / rSize.height()) *
-					rSize.width() / 100);
-			else size.setHeight(
-				(THUMB_SIZE * 100 / rSize.width()) *
-				rSize.height() / 100);
-			
-			reader.setScaledSize(size);
+			job = idleJobs.takeFirst();
+			idleToken = token;
+			token->reset();
+			return true;
 		}
-		
-		if(!reader.canRead())
-		{
-			emit imageIsNull(info.fileName());
-			return;
-		}
-
-		result = reader.read();
-	}
-	else result.load(":/folder64.png");
-	
-	rName = info.fileName();
-	if(result.isNull())
-	{
-		emit imageIsNull(info.fileName());
-		return;
 	}
-	
-	if(result.width() < THUMB_SIZE || result.height() < THUMB_SIZE)
-	{
-		QImage master(THUMB_SIZE, THUMB_SIZE, QImage::Format_ARGB32);
-		painter.begin(&master);
-		painter.fillRect(0, 0, THUMB_SIZE, THUMB_SIZE, QBrush(Qt::white));
-		painter.drawImage(
-			QPoint((THUMB_SIZE - result.width()) / 2,
-				(THUMB_SIZE - result.height()) / 2),
-			result);
-		painter.setPen(QPen(QBrush(Qt::lightGray), 1));
-		painter.drawRect(0, 0, THUMB_SIZE - 1, THUMB_SIZE - 1);
-		painter.end();
+	if(shutdown) return false;
 
-		result = master;
+	// the first job at or behind the start of the visible range is either
+	// visible itself or the closest one below it, its predecessor is the
+	// closest one above
+	QMap<int, PuMP_OverviewJob>::iterator it = jobs.lowerBound(focusFirst);
+	if(it == jobs.end()) it--;
+	else if(it.key() > focusLast && it != jobs.begin())
+	{
+		QMap<int, PuMP_OverviewJob>::iterator prev = it;
+		prev--;
+		if(focusFirst - prev.key() < it.key() - focusLast) it = prev;
 	}
-	
-	emit processedImage(rName, rProperties, result, killed);
-}
-
-/**
- * Function that can be called from the outside of this class to let the
- * thread process the given image.
- * @param	fileinfo	The QFileInfo-Object representing the image to
- * 						process. 
- */
-void PuMP_OverviewLoader::processImage(const QFileInfo &fileInfo)
-{
-	info = fileInfo;
-	reader.setFileName(info.filePath());
-	reader.setScaledSize(QSize());
 
-	size.setWidth(THUMB_SIZE);
-	size.setHeight(THUMB_SIZE);
+	job = it.value();
+	job.level = level;
+	jobs.erase(it);
+	active++;
 
-	start();
+	// reset while locked, so a restart can't slip in between
+	token->reset();
+	return true;
 }
 
 /**
- * Function to mark the current execution of this thread as killed.
- * Needed for a stop-function.
+ * Function that returns the time all workers spent in the stages of the
+ * visible jobs since the last call, summed over the workers.
+ * @return	The times in milliseconds.
  */
-void PuMP_OverviewLoader::setKilled()
+PuMP_OverviewTimes PuMP_OverviewLoader::takeTimes()
 {
-	killed = true;
+	QMutexLocker locker(&mutex);
+	PuMP_OverviewTimes result = times;
+	times = PuMP_OverviewTimes();
+	return result;
 }
 
 /**
- * Function returns whether the last execution of this thread was killed.
- * @return	True if the execution was killed, false otherwise.
+ * Function that shuts down all workers and waits for them to return.
  */
-bool PuMP_OverviewLoader::wasKilled()
+void PuMP_OverviewLoader::wait()
 {
-	return killed;
+	mutex.lock();
+	shutdown = true;
+	generation++;
+	active = 0;
+	jobs.clear();
+	idleJobs.clear();
+	cancelWorkers();
+	condition.wakeAll();
+	mutex.unlock();
+
+	int i;
+	for(i = 0; i < workers.size(); i++) workers.at(i)->wait();
 }
 
 /*****************************************************************************/
@@ -349,10 +1810,16 @@ QAction *PuMP_Overview::openAction = NULL;
  * @param	parent		The parent-widget of this object.
  */
 PuMP_Overview::PuMP_Overview(QWidget *parent)
-	: QListView(parent), PuMP_SettingsInterface()
+	: QListView(parent), PuMP_SettingsInterface(), delegate(&model)
 {
 	progress = 0;
 	progressMax = 1;
+	generation = 0;
+	memory = OVERVIEW_MEMORY;
+	historyMemory = OVERVIEW_HISTORY_MEMORY;
+	indexed = -1;
+	listing = false;
+	rescanning = false;
 
 	PuMP_Overview::openAction = new QAction("Open", this);
 	connect(
@@ -375,39 +1842,100 @@ PuMP_Overview::PuMP_Overview(QWidget *parent)
 		SIGNAL(triggered()),
 		this,
 		SLOT(on_stop()));
+	connect(
+		PuMP_MainWindow::thumbSizeSlider,
+		SIGNAL(valueChanged(int)),
+		this,
+		SLOT(on_thumbSizeSlider_valueChanged(int)));
 
 	model.setParent(this);
 	model.setFontMetrics(fontMetrics());
+	delegate.setParent(this);
 	loader.setParent(this);
-	connect(&loader, SIGNAL(finished()), this, SLOT(on_loader_finished()));
 	connect(
 		&loader,
-		SIGNAL(imageIsNull(const QString &)),
+		SIGNAL(finished(int)),
 		this,
-		SLOT(on_loader_imageIsNull(const QString &)));
+		SLOT(on_loader_finished(int)));
+	connect(
+		&loader,
+		SIGNAL(imageIsNull(int, int, const QString &)),
+		this,
+		SLOT(on_loader_imageIsNull(int, int, const QString &)));
 	connect(
 		&loader,
 		SIGNAL(processedImage(
+			int,
+			int,
+			int,
 			const QString &,
 			const QString &,
-			const QImage &,
-			bool)),
+			const QImage &)),
 		this,
 		SLOT(on_loader_processedImage(
+			int,
+			int,
+			int,
 			const QString &,
 			const QString &,
-			const QImage &,
-			bool)));
+			const QImage &)));
+	reader.setParent(this);
+	commitTimer.setParent(this);
+	commitTimer.setSingleShot(true);
+	commitTimer.setInterval(COMMIT_INTERVAL);
+	connect(
+		&commitTimer,
+		SIGNAL(timeout()),
+		this,
+		SLOT(on_commitTimer_timeout()));
+	rescanTimer.setParent(this);
+	rescanTimer.setSingleShot(true);
+	rescanTimer.setInterval(RESCAN_INTERVAL);
+	connect(
+		&rescanTimer,
+		SIGNAL(timeout()),
+		this,
+		SLOT(on_rescanTimer_timeout()));
+	retryTimer.setParent(this);
+	retryTimer.setSingleShot(true);
+	retryTimer.setInterval(RETRY_INTERVAL);
+	connect(
+		&retryTimer,
+		SIGNAL(timeout()),
+		this,
+		SLOT(on_retryTimer_timeout()));
+	watcher.setParent(this);
+	connect(
+		&watcher,
+		SIGNAL(directoryChanged(const QString &)),
+		this,
+		SLOT(on_watcher_directoryChanged(const QString &)));
+	connect(
+		&watcher,
+		SIGNAL(fileChanged(const QString &)),
+		this,
+		SLOT(on_watcher_fileChanged(const QString &)));
+	connect(
+		&reader,
+		SIGNAL(entriesAvailable(int)),
+		this,
+		SLOT(on_reader_entriesAvailable(int)));
+	connect(
+		&reader,
+		SIGNAL(listingFinished(int)),
+		this,
+		SLOT(on_reader_listingFinished(int)));
 	
 	dir.setNameFilters(PuMP_MainWindow::nameFilters);
 	
 	setViewMode(QListView::ListMode);
 	setFlow(QListView::LeftToRight);
 	setFocusPolicy(Qt::StrongFocus);
-	setIconSize(QSize(THUMB_SIZE, THUMB_SIZE));
+	setIconSize(QSize(model.getThumbSize(), model.getThumbSize()));
 	setLayoutMode(QListView::Batched);
 	setMinimumWidth(450);
 	setModel(&model);
+	setItemDelegate(&delegate);
 	setMovement(QListView::Static);
 	setResizeMode(QListView::Fixed);
 	setSelectionMode(QAbstractItemView::ExtendedSelection);
@@ -438,6 +1966,7 @@ PuMP_Overview::~PuMP_Overview()
 
 	storeSettings();
 	on_stop();
+	loader.wait();
 	model.clear();
 }
 
@@ -449,6 +1978,17 @@ void PuMP_Overview::loadSettings()
 	dirFromSettings = PuMP_MainWindow::settings->value(
 		PUMP_OVERVIEW_DIR,
 		QDir::homePath()).toString();
+	memory = PuMP_MainWindow::settings->value(
+		PUMP_OVERVIEW_MEMORY,
+		OVERVIEW_MEMORY).toInt();
+	model.setBudget((qint64)memory * 1024 * 1024);
+	historyMemory = PuMP_MainWindow::settings->value(
+		PUMP_OVERVIEW_HISTORY,
+		OVERVIEW_HISTORY_MEMORY).toInt();
+	PuMP_MainWindow::thumbSizeSlider->setValue(
+		PuMP_MainWindow::settings->value(
+			PUMP_OVERVIEW_THUMBSIZE,
+			THUMB_SIZE).toInt());
 }
 
 /**
@@ -457,6 +1997,11 @@ void PuMP_Overview::loadSettings()
 void PuMP_Overview::storeSettings()
 {
 	PuMP_MainWindow::settings->setValue(PUMP_OVERVIEW_DIR, dir.path());
+	PuMP_MainWindow::settings->setValue(PUMP_OVERVIEW_MEMORY, memory);
+	PuMP_MainWindow::settings->setValue(PUMP_OVERVIEW_HISTORY, historyMemory);
+	PuMP_MainWindow::settings->setValue(
+		PUMP_OVERVIEW_THUMBSIZE,
+		model.getThumbSize());
 }
 
 /**
@@ -508,6 +2053,32 @@ void PuMP_Overview::save()
 	}
 }
 
+/**
+ * Function that sets the recently visited directories, which are indexed in
+ * the background.
+ * @param	paths	The paths of the directories, the most recent first.
+ */
+void PuMP_Overview::setHistory(const QStringList &paths)
+{
+	history = paths.mid(0, OVERVIEW_HISTORY_SIZE);
+}
+
+/**
+ * Function that resets the actions and the status-bar once the directory was
+ * listed completely and all thumbnails were created.
+ */
+void PuMP_Overview::checkFinished()
+{
+	if(listing || loader.isRunning()) return;
+
+	commitTimer.stop();
+	on_commitTimer_timeout();
+	PuMP_MainWindow::refreshAction->setEnabled(true);
+	PuMP_MainWindow::stopAction->setEnabled(false);
+	emit updateStatusBar(100, QString());
+	startIndexing();
+}
+
 /**
  * Overloaded function for context-menu-events. It provides a custom menu for
  * directories and files.
@@ -556,6 +2127,199 @@ void PuMP_Overview::currentChanged(
 		info.exists() && !info.isDir());
 }
 
+/**
+ * Function that restores the overview of a recently visited directory. The
+ * entries of the snapshot are checked against the new listing, see
+ * on_reader_entriesAvailable().
+ * @param	path	The path of the directory.
+ * @return	True if a snapshot was found, false otherwise.
+ */
+bool PuMP_Overview::popSnapshot(const QString &path)
+{
+	int i;
+	for(i = 0; i < snapshots.size(); i++)
+		if(snapshots.at(i).path == path) break;
+	if(i == snapshots.size()) return false;
+
+	PuMP_OverviewSnapshot snapshot = snapshots.takeAt(i);
+	model.restoreSnapshot(snapshot);
+	current = snapshot.entries;
+	for(i = 0; i < current.size(); i++)
+		stale.insert(current.at(i).fileName(), current.at(i));
+
+	progressMax = qMax(1, current.size());
+	updateFocus();
+	return true;
+}
+
+/**
+ * Function that keeps the overview of the current directory, so it can be
+ * restored when the directory is visited again. The model is empty
+ * afterwards. The least recently visited directories are dropped if there are
+ * more than OVERVIEW_HISTORY_SIZE or their thumbnails exceed the memory set
+ * for the history.
+ */
+void PuMP_Overview::pushSnapshot()
+{
+	if(dir.path().isEmpty() || model.rowCount(QModelIndex()) == 0) return;
+
+	// entries that failed to load are tried again on the next visit
+	PuMP_OverviewSnapshot snapshot;
+	snapshot.path = dir.path();
+	int i;
+	for(i = 0; i < current.size(); i++)
+		if(model.getRowFromName(current.at(i).fileName()) >= 0)
+			snapshot.entries.append(current.at(i));
+	model.takeSnapshot(snapshot);
+	snapshots.prepend(snapshot);
+
+	qint64 bytes = 0;
+	for(i = 0; i < snapshots.size(); i++)
+	{
+		bytes += snapshots.at(i).getBytes();
+		if(i >= OVERVIEW_HISTORY_SIZE ||
+			bytes > (qint64)historyMemory * 1024 * 1024) break;
+	}
+	while(snapshots.size() > i) snapshots.removeLast();
+}
+
+/**
+ * Overloaded function that is called when the view was resized. The loader
+ * is told about the new visible range.
+ * @param	e	The resize-event.
+ */
+void PuMP_Overview::resizeEvent(QResizeEvent *e)
+{
+	QListView::resizeEvent(e);
+	updateFocus();
+}
+
+/**
+ * Overloaded function that is called when the view was scrolled. The loader
+ * is told about the new visible range.
+ * @param	dx	The horizontal distance scrolled.
+ * @param	dy	The vertical distance scrolled.
+ */
+void PuMP_Overview::scrollContentsBy(int dx, int dy)
+{
+	QListView::scrollContentsBy(dx, dy);
+	updateFocus();
+}
+
+/**
+ * Function that lets the loader index the directories likely to be visited
+ * next once the current one is done: the recently visited ones, the
+ * subdirectories and the siblings of the current one. Their thumbnails are
+ * then found in the thumbnail-cache.
+ */
+void PuMP_Overview::startIndexing()
+{
+	if(generation < 0 || indexed == generation) return;
+	indexed = generation;
+
+	QStringList seen;
+	seen.append(dir.path());
+	QList<QFileInfo> dirs;
+	int i;
+	for(i = 0; i < history.size(); i++)
+	{
+		if(seen.contains(history.at(i))) continue;
+		seen.append(history.at(i));
+		dirs.append(QFileInfo(history.at(i)));
+	}
+	for(i = 0; i < current.size(); i++)
+		if(current.at(i).isDir()) dirs.append(current.at(i));
+	loader.index(dirs);
+
+	QDir parent(dir);
+	if(parent.cdUp())
+	{
+		QList<QFileInfo> parents;
+		parents.append(QFileInfo(parent.path()));
+		loader.index(parents, true);
+	}
+}
+
+/**
+ * Function that determines the range of rows currently visible in the
+ * viewport and passes it to the loader, so these are thumbnailed first.
+ */
+void PuMP_Overview::updateFocus()
+{
+	if(model.rowCount(QModelIndex()) == 0) return;
+
+	QRect area = viewport()->rect();
+	QModelIndex first = indexAt(area.topLeft());
+	QModelIndex last = indexAt(area.bottomRight());
+
+	// the corners may hit the spacing between items, so the range is
+	// estimated from the item-size if no item was found there
+	int thumbSize = model.getThumbSize();
+	QSize item(
+		(int)(ITEM_STRETCH * thumbSize) + ITEM_SPACING,
+		thumbSize + 2 * ITEM_SPACING);
+	int perLine = qMax(1, area.width() / item.width());
+	int lines = area.height() / item.height() + 1;
+
+	int firstRow = 0;
+	if(first.isValid()) firstRow = first.row();
+	else
+	{
+		first = indexAt(QPoint(item.width() / 2, item.height() / 2));
+		if(first.isValid()) firstRow = qMax(0, first.row() - perLine);
+	}
+
+	int lastRow = firstRow + perLine * (lines + 1);
+	if(last.isValid()) lastRow = last.row();
+
+	// failed entries are removed from the model and the listing alike, so
+	// the rows of the model are the indices of the loader's jobs
+	loader.setFocus(firstRow, lastRow);
+	model.setVisibleRange(firstRow, lastRow);
+
+	// thumbnails released because of the memory-budget or a new
+	// thumbnail-size are created again, usually straight from the
+	// thumbnail-cache; after a stop they get a generation of their own that
+	// doesn't index the directories around
+	QList<int> missing = model.requestMissing(firstRow, lastRow);
+	if(missing.isEmpty()) return;
+	if(generation < 0)
+	{
+		generation = loader.restart();
+		indexed = generation;
+	}
+
+	int i;
+	for(i = 0; i < missing.size(); i++)
+	{
+		int row = missing.at(i);
+		QString name = model.getItem(row).name;
+		if(row >= current.size() || current.at(row).fileName() != name)
+		{
+			for(row = 0; row < current.size(); row++)
+				if(current.at(row).fileName() == name) break;
+			if(row == current.size()) continue;
+		}
+
+		QList<QFileInfo> info;
+		info.append(current.at(row));
+		loader.processImages(info, row);
+	}
+}
+
+/**
+ * Function that watches a single file of the current directory. Watching the
+ * directory only reports created and removed entries, so files that are
+ * still written to (or failed to load) are watched until they settled.
+ * @param	info	The file as it was listed or thumbnailed.
+ */
+void PuMP_Overview::watchFile(const QFileInfo &info)
+{
+	if(!watchedFiles.contains(info.fileName()))
+		watcher.addPath(info.filePath());
+	watchedFiles.insert(info.fileName(), info);
+}
+
 /**
  * Slot-function that is called when an entry in this list-view was activated.
  * @param	index	The index of the activated item.
@@ -578,36 +2342,205 @@ void PuMP_Overview::on_activated(const QModelIndex &index, bool newTab)
 }
 
 /**
- * Slot-function that is called when the thread processing the preview-images
- * returns from its main-funtion. If necessary, a the next execution will be
- * scheduled here.
+ * Slot-function that hands all thumbnails finished since the last call to the
+ * model at once, so the view is only updated once per interval.
  */
-void PuMP_Overview::on_loader_finished()
+void PuMP_Overview::on_commitTimer_timeout()
 {
-	progress++;
+	if(results.isEmpty()) return;
 
-	if(!current.isEmpty())
+	model.setImages(results);
+	emit updateStatusBar(
+		qMin(100, progress * 100 / progressMax),
+		results.last().name);
+	results.clear();
+}
+
+/**
+ * Slot-function that lists the current directory again after it changed on
+ * disk. Like a restored snapshot, the listing is checked against the entries
+ * already shown, so only new and modified files are thumbnailed and removed
+ * ones are dropped. Jobs still queued are kept.
+ */
+void PuMP_Overview::on_rescanTimer_timeout()
+{
+	if(generation < 0 || !dir.exists()) return;
+
+	// changes during a listing are picked up once it finished
+	if(listing)
+	{
+		rescanTimer.start();
+		return;
+	}
+
+	stale.clear();
+	int i;
+	for(i = 0; i < current.size(); i++)
+		stale.insert(current.at(i).fileName(), current.at(i));
+
+	progress = 0;
+	progressMax = qMax(1, current.size());
+	listing = true;
+	rescanning = true;
+	reader.read(dir.path(), dir.nameFilters(), generation);
+}
+
+/**
+ * Slot-function that thumbnails watched files again once they changed on
+ * disk. Entries that failed to load are added back, shown ones are replaced
+ * in place. Files that weren't modified for RETRY_WINDOW seconds and have a
+ * thumbnail aren't watched any longer.
+ */
+void PuMP_Overview::on_retryTimer_timeout()
+{
+	if(generation < 0) return;
+
+	// a listing picks up the changes itself
+	if(listing)
+	{
+		retryTimer.start();
+		return;
+	}
+
+	QList<QFileInfo> added;
+	int i;
+	for(i = 0; i < changedFiles.size(); i++)
 	{
-		QFileInfo info = current.takeFirst();
-		emit updateStatusBar(progress * 100 / progressMax, info.fileName());
+		QString name = changedFiles.at(i);
+		QFileInfo old = watchedFiles.value(name);
+		QFileInfo info(dir, name);
+		if(!info.exists() ||
+			(info.lastModified() == old.lastModified() &&
+			info.size() == old.size())) continue;
+
+		watchedFiles.insert(name, info);
+		int row = model.getRowFromName(name);
+		if(row < 0)
+		{
+			added.append(info);
+			continue;
+		}
+
+		int index;
+		for(index = 0; index < current.size(); index++)
+		{
+			if(current.at(index).fileName() != name) continue;
+
+			current[index] = info;
+			break;
+		}
+		model.invalidate(row);
+		QList<QFileInfo> job;
+		job.append(info);
+		loader.processImages(job, row);
+	}
+	changedFiles.clear();
 
-		loader.processImage(info);
+	if(!added.isEmpty())
+	{
+		QStringList names;
+		for(i = 0; i < added.size(); i++)
+			names.append(added.at(i).fileName());
+		model.addEntries(names);
+		loader.processImages(added, current.size());
+		current += added;
+		progressMax = current.size();
+		updateFocus();
 	}
-	else
+
+	QDateTime settled = QDateTime::currentDateTime().addSecs(-RETRY_WINDOW);
+	QStringList names = watchedFiles.keys();
+	for(i = 0; i < names.size(); i++)
 	{
-		PuMP_MainWindow::refreshAction->setEnabled(true);
-		PuMP_MainWindow::stopAction->setEnabled(false);
-		emit updateStatusBar(100, QString());
+		const QFileInfo &info = watchedFiles[names.at(i)];
+		if(QFile::exists(info.filePath()) &&
+			(info.lastModified() > settled ||
+			model.getRowFromName(names.at(i)) < 0)) continue;
+
+		watcher.removePath(info.filePath());
+		watchedFiles.remove(names.at(i));
 	}
 }
 
 /**
- * Slot-function that is called when the picture in a thread couldn't get
- * loaded or scaled.
- * @param	info	The file that failed to load/scale.
+ * Slot-function that is called when a watched file was written to, e.g. by a
+ * camera or a download that isn't finished yet. Bursts of writes are
+ * collected for RETRY_INTERVAL milliseconds.
+ * @param	path	The path of the changed file.
+ */
+void PuMP_Overview::on_watcher_fileChanged(const QString &path)
+{
+	QString name = QFileInfo(path).fileName();
+	if(!watchedFiles.contains(name)) return;
+
+	if(!changedFiles.contains(name)) changedFiles.append(name);
+	retryTimer.start();
+}
+
+/**
+ * Slot-function that is called when an entry of the current directory was
+ * created, removed, renamed or modified. Bursts of changes (e.g. a camera
+ * copying its pictures) are collected for RESCAN_INTERVAL milliseconds.
+ * @param	path	The path of the changed directory.
+ */
+void PuMP_Overview::on_watcher_directoryChanged(const QString &path)
+{
+	if(path != dir.path()) return;
+	rescanTimer.start();
+}
+
+/**
+ * Slot-function that is called when the loader processed all images of a
+ * directory.
+ * @param	generation	The generation of the finished jobs.
+ */
+void PuMP_Overview::on_loader_finished(int generation)
+{
+	if(generation != this->generation) return;
+	checkFinished();
+}
+
+/**
+ * Slot-function that is called when a picture couldn't get loaded or scaled.
+ * Its entry is removed from the model and the listing, so the next rescan
+ * adds it again (e.g. once a camera finished writing it). Failures during a
+ * rescan are only reported on the debug-output.
+ * @param	generation	The generation of the failed job.
+ * @param	index		The index of the file in the current directory.
+ * @param	fileName	The file that failed to load/scale.
  */
-void PuMP_Overview::on_loader_imageIsNull(const QString &fileName)
+void PuMP_Overview::on_loader_imageIsNull(
+	int generation,
+	int index,
+	const QString &fileName)
 {
+	Q_UNUSED(index);
+	if(generation != this->generation) return;
+
+	progress++;
+	model.removeRows(model.getRowFromName(fileName), 1, QModelIndex());
+
+	int i;
+	for(i = 0; i < current.size(); i++)
+	{
+		if(current.at(i).fileName() != fileName) continue;
+
+		// the file is retried once it changes, or right away if it was
+		// still written to after the listing
+		watchFile(current.at(i));
+		if(!changedFiles.contains(fileName)) changedFiles.append(fileName);
+		retryTimer.start();
+		current.removeAt(i);
+		loader.reorder(current);
+		break;
+	}
+
+	if(rescanning)
+	{
+		qDebug() << "Cannot create thumbnail for entry" << fileName;
+		return;
+	}
+
 	QMessageBox::information(
 		this,
 		"Information",
@@ -615,24 +2548,35 @@ void PuMP_Overview::on_loader_imageIsNull(const QString &fileName)
 }
 
 /**
- * Slot-function that is called when the thread finished the processing of an
- * image. The image will then be inserted into the model and so be displayed.
+ * Slot-function that is called when a worker finished the processing of an
+ * image. The thumbnail is collected and set in the model with the next
+ * commit.
+ * @param	generation	The generation of the processed job.
+ * @param	index		The index of the file in the current directory.
+ * @param	level		The level of the thumbnail.
  * @param	name		The file-name of the image that was processed.
  * @param	properties	The property-string of the image.
  * @param	image		The scaled image itself.
- * @param	wasKilled	Flag indicating whether the thread was killed or not.
  */
 void PuMP_Overview::on_loader_processedImage(
+	int generation,
+	int index,
+	int level,
 	const QString &name,
 	const QString &properties,
-	const QImage &image,
-	bool wasKilled)
+	const QImage &image)
 {
-	if(!wasKilled)
-	{
-		model.addImage(QPixmap::fromImage(image), name, properties);
-		update();
-	}
+	Q_UNUSED(index);
+	if(generation != this->generation) return;
+
+	progress++;
+	PuMP_OverviewResult result;
+	result.level = level;
+	result.name = name;
+	result.properties = properties;
+	result.image = image;
+	results.append(result);
+	if(!commitTimer.isActive()) commitTimer.start();
 }
 
 /**
@@ -653,35 +2597,196 @@ void PuMP_Overview::on_open(const QFileInfo &info)
 	if(dir.path() != info.filePath())
 	{
 		on_stop();
+		pushSnapshot();
 		model.clear();
+		current.clear();
+		stale.clear();
 
+		QStringList watched = watcher.directories() + watcher.files();
+		if(!watched.isEmpty()) watcher.removePaths(watched);
+		watchedFiles.clear();
+		changedFiles.clear();
 		dir.setPath(info.filePath());
 		dir.refresh();
-		current = dir.entryInfoList(
-			QDir::Files | QDir::AllDirs |
-			QDir::NoDotAndDotDot | QDir::Readable,
-			QDir::Name | QDir::DirsFirst);
+		watcher.addPath(dir.path());
 	
 		progress = 0;
 		progressMax = 1;
-		
-		if(!current.isEmpty())
+		listing = true;
+		rescanning = false;
+
+		PuMP_MainWindow::refreshAction->setEnabled(false);
+		PuMP_MainWindow::stopAction->setEnabled(true);
+		emit updateStatusBar(0, info.fileName());
+
+		generation = loader.restart();
+		popSnapshot(dir.path());
+		reader.read(dir.path(), dir.nameFilters(), generation);
+	}
+}
+
+/**
+ * Slot-function that is called when the reader listed further entries of the
+ * current directory. They are shown right away and queued for thumbnailing.
+ * @param	generation	The generation of the listing.
+ */
+void PuMP_Overview::on_reader_entriesAvailable(int generation)
+{
+	if(generation != this->generation) return;
+
+	QList<QFileInfo> infos = reader.takeEntries();
+	if(infos.isEmpty()) return;
+
+	// entries of a restored snapshot are only thumbnailed again if they
+	// were modified since, recently modified files may still be written to
+	QDateTime settled = QDateTime::currentDateTime().addSecs(-RETRY_WINDOW);
+	QList<QFileInfo> added;
+	QHash<QString, QFileInfo> modified;
+	int i;
+	for(i = 0; i < infos.size(); i++)
+	{
+		const QFileInfo &info = infos.at(i);
+		if(!info.isDir() && info.lastModified() > settled) watchFile(info);
+		if(!stale.contains(info.fileName()))
+		{
+			added.append(info);
+			continue;
+		}
+
+		QFileInfo old = stale.take(info.fileName());
+		int row = model.getRowFromName(info.fileName());
+		if(row < 0)
+		{
+			// the entry was dropped from the model, it is shown again
+			current.removeAll(old);
+			added.append(info);
+			continue;
+		}
+		if(model.getItem(row).loaded &&
+			old.lastModified() == info.lastModified() &&
+			old.size() == info.size())
+		{
+			progress++;
+			continue;
+		}
+
+		modified.insert(info.fileName(), info);
+		model.invalidate(row);
+		QList<QFileInfo> job;
+		job.append(info);
+		loader.processImages(job, row);
+	}
+
+	if(!modified.isEmpty())
+	{
+		for(i = 0; i < current.size(); i++)
+			if(modified.contains(current.at(i).fileName()))
+				current[i] = modified.value(current.at(i).fileName());
+	}
+
+	if(!added.isEmpty())
+	{
+		QStringList names;
+		QStringList files;
+		for(i = 0; i < added.size(); i++)
+		{
+			names.append(added.at(i).fileName());
+			if(!added.at(i).isDir()) files.append(added.at(i).fileName());
+		}
+		model.addEntries(names);
+
+		// a rescan updates the image-views' listing as it goes
+		if(rescanning && PuMP_MainWindow::siblingIndex != NULL)
+			PuMP_MainWindow::siblingIndex->addEntries(
+				dir.absolutePath(),
+				files);
+
+		loader.processImages(added, current.size());
+		current += added;
+		progressMax = current.size();
+	}
+	updateFocus();
+}
+
+/**
+ * Function used for sorting the directory-listing. Directories come first,
+ * both groups are sorted by name.
+ */
+static bool entryLessThan(const QFileInfo &a, const QFileInfo &b)
+{
+	if(a.isDir() != b.isDir()) return a.isDir();
+	return a.fileName() < b.fileName();
+}
+
+/**
+ * Slot-function that is called when the reader listed all entries of the
+ * current directory. Because the entries arrive in the order of the
+ * file-system, the listing is sorted here in one pass.
+ * @param	generation	The generation of the listing.
+ */
+void PuMP_Overview::on_reader_listingFinished(int generation)
+{
+	if(generation != this->generation) return;
+	listing = false;
+
+	// entries of a restored snapshot that weren't listed again are gone
+	int i;
+	if(!stale.isEmpty())
+	{
+		QList<QFileInfo> kept;
+		QStringList removed;
+		for(i = 0; i < current.size(); i++)
 		{
-			PuMP_MainWindow::refreshAction->setEnabled(false);
-			PuMP_MainWindow::stopAction->setEnabled(true);
-			progressMax = current.size();
-			QFileInfo first = current.first();
-			emit updateStatusBar(
-				progress * 100 / progressMax,
-				first.fileName());
-			
-			if(!loader.isRunning())
+			QString name = current.at(i).fileName();
+			if(!stale.contains(name))
 			{
-				first = current.takeFirst();
-				loader.processImage(first);
+				kept.append(current.at(i));
+				continue;
 			}
+
+			removed.append(name);
+			model.removeRows(model.getRowFromName(name), 1, QModelIndex());
 		}
+		current = kept;
+
+		if(rescanning && PuMP_MainWindow::siblingIndex != NULL)
+			PuMP_MainWindow::siblingIndex->removeEntries(
+				dir.absolutePath(),
+				removed);
+		stale.clear();
+		progressMax = qMax(1, current.size());
+	}
+
+	QList<QFileInfo> sorted = current;
+	qStableSort(sorted.begin(), sorted.end(), entryLessThan);
+
+	bool changed = false;
+	for(i = 0; i < sorted.size() && !changed; i++)
+		changed = sorted.at(i).fileName() != current.at(i).fileName();
+
+	if(changed)
+	{
+		QStringList names;
+		for(i = 0; i < sorted.size(); i++)
+			names.append(sorted.at(i).fileName());
+
+		current = sorted;
+		model.reorder(names);
+		loader.reorder(current);
+		updateFocus();
+	}
+
+	// the image-views step through the same listing, a rescan handed over
+	// its changes already
+	if(!rescanning && PuMP_MainWindow::siblingIndex != NULL)
+	{
+		QStringList files;
+		for(i = 0; i < current.size(); i++)
+			if(!current.at(i).isDir()) files.append(current.at(i).fileName());
+		PuMP_MainWindow::siblingIndex->setEntries(dir.absolutePath(), files);
 	}
+
+	checkFinished();
 }
 
 /**
@@ -730,20 +2835,43 @@ void PuMP_Overview::on_refresh()
 	}
 }
 
+/**
+ * Slot-function that is called when the user changed the thumbnail-size.
+ * Thumbnails of the needed level are requested again, usually they are
+ * found in the thumbnail-cache.
+ * @param	value	The new thumbnail-size.
+ */
+void PuMP_Overview::on_thumbSizeSlider_valueChanged(int value)
+{
+	model.setThumbSize(value);
+	loader.setLevel(model.getLevel());
+	setIconSize(QSize(model.getThumbSize(), model.getThumbSize()));
+	updateFocus();
+}
+
 /**
  * Function that stops a running calcultion of a preview (e.g. if the directory
  * is too large or the user is too impatient).
  */
 void PuMP_Overview::on_stop()
 {
+	PuMP_MainWindow::refreshAction->setEnabled(true);
 	PuMP_MainWindow::stopAction->setEnabled(false);
 	
 	progress = 0;
 	progressMax = 1;
-	current.clear();
 	emit updateStatusBar(100, QString());
 
+	listing = false;
+	commitTimer.stop();
+	rescanTimer.stop();
+	retryTimer.stop();
+	changedFiles.clear();
+	results.clear();
+	reader.stop();
 	loader.setKilled();
+	model.cancelRequests();
+	generation = -1;
 }
 
 /*****************************************************************************/
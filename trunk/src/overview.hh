@@ -22,27 +22,132 @@
 #ifndef OVERVIEW_HH_
 #define OVERVIEW_HH_
 
+#include <QAbstractItemDelegate>
 #include <QAbstractListModel>
 #include <QAction>
 #include <QDir>
 #include <QFileInfo>
+#include <QFileSystemWatcher>
 #include <QFontMetrics>
+#include <QHash>
 #include <QImage>
 #include <QImageReader>
 #include <QList>
 #include <QListView>
+#include <QMap>
+#include <QMutex>
 #include <QPainter>
+#include <QPair>
 #include <QPixmap>
 #include <QStringList>
+#include <QStyleOptionViewItem>
 #include <QThread>
+#include <QTime>
+#include <QTimer>
+#include <QWaitCondition>
 
+#include "cancelToken.hh"
 #include "settings.hh"
 
 #define THUMB_SIZE			64
+#define THUMB_LEVELS		3
 #define ICON_PADDING		10
 #define ITEM_STRETCH		2.5
 #define ITEM_SPACING		10
+#define ATLAS_PAGE_SIZE		1024
+#define COMMIT_INTERVAL		40
+#define READER_BATCH_SIZE	64
+#define READER_BATCH_TIME	50
+#define RESCAN_INTERVAL		500
+#define RETRY_INTERVAL		1000
+#define RETRY_WINDOW		60
+#define INDEXER_MAX_FILES	1000
+#define INDEXER_PAUSE		50
+#define OVERVIEW_MEMORY		32
+#define OVERVIEW_HISTORY_MEMORY	64
+#define OVERVIEW_HISTORY_SIZE	8
 #define PUMP_OVERVIEW_DIR	"PuMP_Overview::dir"
+#define PUMP_OVERVIEW_HISTORY	"PuMP_Overview::history"
+#define PUMP_OVERVIEW_MEMORY	"PuMP_Overview::memory"
+#define PUMP_OVERVIEW_THUMBSIZE	"PuMP_Overview::thumbSize"
+#define PUMP_OVERVIEWLOADER_THREADS	"PuMP_OverviewLoader::threads"
+#define PUMP_OVERVIEWLOADER_WRITESHARED	"PuMP_OverviewLoader::writeShared"
+
+/******************************************************************************/
+
+class PuMP_OverviewResult
+{
+	public:
+		int level;
+		QString name;
+		QString properties;
+		QImage image;
+};
+
+/******************************************************************************/
+
+class PuMP_OverviewAtlas
+{
+	protected:
+		int perLine;
+		int perPage;
+		int slotSize;
+
+		QList<QPixmap> pages;
+		QList<int> freeSlots;
+
+		QRect slotRect(int slot) const;
+
+	public:
+		PuMP_OverviewAtlas();
+
+		int allocate();
+		void clear();
+		void draw(
+			QPainter *painter,
+			const QRect &target,
+			int slot,
+			const QSize &size) const;
+		qint64 getBytes() const;
+		void release(int slot);
+		void setSlotSize(int size);
+		void store(int slot, const QImage &image);
+};
+
+/******************************************************************************/
+
+class PuMP_OverviewItem
+{
+	public:
+		bool loaded;
+		bool requested;
+		quint32 lastUsed;
+		int slot;
+		QSize size;
+		QString name;
+		QString text;
+
+		PuMP_OverviewItem();
+};
+
+/******************************************************************************/
+
+class PuMP_OverviewSnapshot
+{
+	public:
+		quint32 clock;
+		int level;
+		int thumbSize;
+		int usedSlots;
+
+		QString path;
+		PuMP_OverviewAtlas atlas;
+		QList<PuMP_OverviewItem> items;
+		QList<QFileInfo> entries;
+		QMap<quint32, QPair<QString, int> > lru;
+
+		qint64 getBytes() const;
+};
 
 /******************************************************************************/
 
@@ -52,19 +157,30 @@ class PuMP_OverviewModel : public QAbstractListModel
 
 	protected:
 		QFontMetrics *fontMetrics;
+		qint64 budget;
+		quint32 clock;
+		int level;
+		int maxSlots;
+		int thumbSize;
+		int usedSlots;
+		int visibleFirst;
+		int visibleLast;
+
+		PuMP_OverviewAtlas atlas;
+		QList<PuMP_OverviewItem> items;
+		QHash<QString, int> rows;
+		QMap<quint32, QPair<QString, int> > lru;
 
-		QList<QPixmap> pixmaps;
-		QStringList names;
-		QStringList properties;
+		QString elide(const QString &name) const;
+		bool evict();
+		void release(PuMP_OverviewItem &item);
 	
 	public:
 		PuMP_OverviewModel(QFontMetrics *fontMetrics = 0, QObject *parent = 0);
 		~PuMP_OverviewModel();
 
-		void addImage(
-			const QPixmap &pixmap,
-			const QString &name,
-			const QString &props);
+		void addEntries(const QStringList &names);
+		void cancelRequests();
 		void clear();
 
 		QVariant data(
@@ -72,47 +188,223 @@ class PuMP_OverviewModel : public QAbstractListModel
 			int role = Qt::DisplayRole) const;
 
 		Qt::ItemFlags flags(const QModelIndex &index) const;
+		const PuMP_OverviewAtlas &getAtlas() const;
 		QString getFileName(const QModelIndex &index) const;
+		const PuMP_OverviewItem &getItem(int row) const;
+		int getLevel() const;
+		int getThumbSize() const;
 		int getRowFromName(const QString &name) const;
+		void invalidate(int row);
 		bool removeRows(int row, int count, const QModelIndex &parent);
+		void reorder(const QStringList &order);
+		QList<int> requestMissing(int first, int last);
+		void restoreSnapshot(const PuMP_OverviewSnapshot &snapshot);
 		int rowCount(const QModelIndex &parent) const;
+		void setBudget(qint64 bytes);
 		void setFontMetrics(const QFontMetrics &fontMetrics);
+		void setImages(const QList<PuMP_OverviewResult> &results);
+		void setThumbSize(int size);
+		void setVisibleRange(int first, int last);
+		void takeSnapshot(PuMP_OverviewSnapshot &snapshot);
+		void touch(int row);
 };
 
 /******************************************************************************/
 
-class PuMP_OverviewLoader : public QThread
+class PuMP_OverviewDelegate : public QAbstractItemDelegate
 {
 	Q_OBJECT
-	
+
 	protected:
-		bool killed;
+		PuMP_OverviewModel *model;
+
+	public:
+		PuMP_OverviewDelegate(PuMP_OverviewModel *model, QObject *parent = 0);
+
+		void paint(
+			QPainter *painter,
+			const QStyleOptionViewItem &option,
+			const QModelIndex &index) const;
+		QSize sizeHint(
+			const QStyleOptionViewItem &option,
+			const QModelIndex &index) const;
+};
+
+/******************************************************************************/
+
+class PuMP_DirectoryReader : public QThread
+{
+	Q_OBJECT
+
+	protected:
+		int generation;
+		bool pending;
+		bool shutdown;
+		bool stopped;
+
+		QString path;
+		QStringList nameFilters;
+		QList<QFileInfo> entries;
+		QMutex mutex;
+		QWaitCondition condition;
+
+		bool isCurrent(int generation);
+		void list(
+			const QString &path,
+			const QStringList &nameFilters,
+			int generation);
+		void run();
+
+	public:
+		PuMP_DirectoryReader(QObject *parent = 0);
+		~PuMP_DirectoryReader();
+
+		void read(
+			const QString &path,
+			const QStringList &nameFilters,
+			int generation);
+		void stop();
+		QList<QFileInfo> takeEntries();
+
+	signals:
+		void entriesAvailable(int generation);
+		void listingFinished(int generation);
+};
+
+/******************************************************************************/
+
+class PuMP_OverviewLoader;
+
+/******************************************************************************/
+
+class PuMP_OverviewJob
+{
+	public:
+		int generation;
+		int index;
+		int level;
+		bool idle;
+		bool subdirs;
 		QFileInfo info;
+
+		PuMP_OverviewJob();
+};
+
+/******************************************************************************/
+
+class PuMP_OverviewTimes
+{
+	public:
+		int lookup;
+		int decode;
+		int scale;
+		int store;
+
+		PuMP_OverviewTimes();
+};
+
+/******************************************************************************/
+
+class PuMP_OverviewWorker : public QThread
+{
+	Q_OBJECT
+	
+	protected:
+		int lastLap;
+
+		PuMP_OverviewLoader *loader;
+		PuMP_OverviewTimes times;
+		PuMP_CancelToken token;
 		QImageReader reader;
-		QPainter painter;
-		QSize size;
+		QTime clock;
 		
+		QList<QImage> createLevels(
+			const QImage &image,
+			const QSize &imageSize);
+		bool createThumbnail(
+			const QFileInfo &info,
+			int level,
+			QImage &result,
+			QString &properties);
+		bool indexEntry(
+			const PuMP_OverviewJob &job,
+			QList<QFileInfo> &found);
+		void lap(int &stage);
+		QImage pickLevel(
+			const QList<QImage> &levels,
+			const QSize &imageSize,
+			int level);
 		void run();
 	
 	public:
-		QImage result;
-		QSize rSize;
-		QString rName;
-		QString rProperties;
+		PuMP_OverviewWorker(PuMP_OverviewLoader *loader);
+
+		void cancel();
+};
 
+/******************************************************************************/
+
+class PuMP_OverviewLoader : public QObject
+{
+	Q_OBJECT
+	
+	protected:
+		int active;
+		int generation;
+		int focusFirst;
+		int focusLast;
+		int level;
+		int idleLeft;
+		bool shutdown;
+		bool writeShared;
+
+		PuMP_CancelToken *idleToken;
+		PuMP_OverviewTimes times;
+		QTime idleTime;
+		QList<PuMP_OverviewJob> idleJobs;
+		QMap<int, PuMP_OverviewJob> jobs;
+		QList<PuMP_OverviewWorker *> workers;
+		QMutex mutex;
+		QWaitCondition condition;
+
+		void cancelWorkers();
+	
+	public:
 		PuMP_OverviewLoader(QObject *parent = 0);
+		~PuMP_OverviewLoader();
 		
-		void processImage(const QFileInfo &fileInfo);
+		void addTimes(const PuMP_OverviewTimes &times);
+		void finishJob(
+			const PuMP_OverviewJob &job,
+			const QImage &image,
+			const QString &properties);
+		void finishIdleJob(
+			const PuMP_OverviewJob &job,
+			bool done,
+			const QList<QFileInfo> &found);
+		bool getWriteShared() const;
+		void index(const QList<QFileInfo> &dirs, bool subdirs = false);
+		bool isRunning();
+		void processImages(const QList<QFileInfo> &infos, int first);
+		void reorder(const QList<QFileInfo> &order);
+		int restart();
+		void setFocus(int first, int last);
 		void setKilled();
-		bool wasKilled();
+		void setLevel(int level);
+		bool takeJob(PuMP_OverviewJob &job, PuMP_CancelToken *token);
+		PuMP_OverviewTimes takeTimes();
+		void wait();
 	
 	signals:
-		void imageIsNull(const QString &fileName);
+		void finished(int generation);
+		void imageIsNull(int generation, int index, const QString &fileName);
 		void processedImage(
+			int generation,
+			int index,
+			int level,
 			const QString &name,
 			const QString &properties,
-			const QImage &image,
-			bool wasKilled);
+			const QImage &image);
 };
 
 /******************************************************************************/
@@ -122,20 +414,46 @@ class PuMP_Overview : public QListView, public PuMP_SettingsInterface
 	Q_OBJECT
 	
 	protected:
+		int generation;
 		int progress;
 		int progressMax;
+		int memory;
+		int historyMemory;
+		int indexed;
+		bool listing;
+		bool rescanning;
 
 		PuMP_OverviewModel model;
+		PuMP_OverviewDelegate delegate;
 		PuMP_OverviewLoader loader;
+		PuMP_DirectoryReader reader;
 
 		QDir dir;
 		QString dirFromSettings;
+		QStringList history;
 		QList<QFileInfo> current;
+		QList<PuMP_OverviewResult> results;
+		QList<PuMP_OverviewSnapshot> snapshots;
+		QHash<QString, QFileInfo> stale;
+		QHash<QString, QFileInfo> watchedFiles;
+		QStringList changedFiles;
+		QFileSystemWatcher watcher;
+		QTimer commitTimer;
+		QTimer rescanTimer;
+		QTimer retryTimer;
 		
 		void contextMenuEvent(QContextMenuEvent *e);
+		void checkFinished();
 		void currentChanged(
 			const QModelIndex &current,
 			const QModelIndex &previous);
+		bool popSnapshot(const QString &path);
+		void pushSnapshot();
+		void resizeEvent(QResizeEvent *e);
+		void scrollContentsBy(int dx, int dy);
+		void startIndexing();
+		void updateFocus();
+		void watchFile(const QFileInfo &info);
 	
 	public:
 		static QAction *openAction;
@@ -146,23 +464,39 @@ class PuMP_Overview : public QListView, public PuMP_SettingsInterface
 		void loadSettings();
 		void storeSettings();
 		void save();
+		void setHistory(const QStringList &paths);
 		
 	public slots:
 		void on_activated(const QModelIndex &index, bool newTab = true);
+		void on_commitTimer_timeout();
+		void on_rescanTimer_timeout();
+		void on_retryTimer_timeout();
 
-		void on_loader_finished();
-		void on_loader_imageIsNull(const QString &fileName);
+		void on_reader_entriesAvailable(int generation);
+		void on_reader_listingFinished(int generation);
+
+		void on_watcher_directoryChanged(const QString &path);
+		void on_watcher_fileChanged(const QString &path);
+
+		void on_loader_finished(int generation);
+		void on_loader_imageIsNull(
+			int generation,
+			int index,
+			const QString &fileName);
 		void on_loader_processedImage(
+			int generation,
+			int index,
+			int level,
 			const QString &name,
 			const QString &properties,
-			const QImage &image,
-			bool wasKilled);
+			const QImage &image);
 		
 		void on_open(const QFileInfo &info);
 		void on_openAction_triggered();
 		void on_openInNewTabAction_triggered();
 		void on_refresh();
 		void on_stop();
+		void on_thumbSizeSlider_valueChanged(int value);
 	
 	signals:
 		void openImage(const QFileInfo &info, bool newPage);
@@ -0,0 +1,418 @@
+/*
+ * Copyright 2007 Christoph Werle, Tobias Schlager
+ * 
+ * This file is part of "PuMP - Publish My Pictures".
+ *
+ * "Publish My Pictures" is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * "Publish My Pictures" is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with "Publish My Pictures"; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ */
+
+#include <math.h>
+
+#include <QList>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#include "resampler.hh"
+
+/*****************************************************************************/
+
+/**
+ * Function that turns a fixed-point sum into a channel-value.
+ */
+static inline uchar toChannel(int sum)
+{
+	sum >>= RESAMPLER_PRECISION;
+	return sum < 0 ? 0 : (sum > 255 ? 255 : sum);
+}
+
+/**
+ * Function that keeps the colors of a premultiplied pixel below its alpha,
+ * the negative lobes of the Lanczos-filter may push them above.
+ */
+static inline void limitToAlpha(QRgb &pixel)
+{
+	int a = qAlpha(pixel);
+	if(qRed(pixel) > a || qGreen(pixel) > a || qBlue(pixel) > a)
+		pixel = qRgba(
+			qMin(qRed(pixel), a),
+			qMin(qGreen(pixel), a),
+			qMin(qBlue(pixel), a),
+			a);
+}
+
+/*****************************************************************************/
+
+/**
+ * Constructor of class PuMP_ResamplerBand, a thread that resamples a band of
+ * lines of an image.
+ * @param	resampler	The resampler.
+ * @param	vertical	True for the vertical pass, false for the horizontal
+ * 						one.
+ * @param	first		The first line of the band.
+ * @param	last		The line following the band.
+ */
+PuMP_ResamplerBand::PuMP_ResamplerBand(
+	PuMP_Resampler *resampler,
+	bool vertical,
+	int first,
+	int last)
+	: QThread()
+{
+	this->resampler = resampler;
+	this->vertical = vertical;
+	this->first = first;
+	this->last = last;
+}
+
+/**
+ * The overloaded main-function of this thread, which resamples the band.
+ */
+void PuMP_ResamplerBand::run()
+{
+	if(vertical) resampler->resampleRows(first, last);
+	else resampler->resampleColumns(first, last);
+}
+
+/*****************************************************************************/
+
+/**
+ * Constructor of class PuMP_Resampler. The image is resampled in two
+ * separable passes, first its lines are resampled to the new width, then its
+ * columns to the new height. The weights of the filter are computed once per
+ * target-column and -line, as fixed-point numbers.
+ * @param	image	The image to resample.
+ * @param	size	The size of the result.
+ * @param	filter	The filter to use.
+ * @param	threads	The number of threads to use, 0 to use one per
+ * 					processor.
+ * @param	token	If given, the resampling stops as soon as it is
+ * 					cancelled.
+ */
+PuMP_Resampler::PuMP_Resampler(
+	const QImage &image,
+	const QSize &size,
+	Filter filter,
+	int threads,
+	const PuMP_CancelToken *token)
+{
+	this->threads = threads > 0 ? threads : QThread::idealThreadCount();
+	this->token = token;
+	columnTaps = 0;
+	rowTaps = 0;
+
+	// all channels are treated alike, which averages the colors correctly
+	// only if they are premultiplied with the alpha
+	premultiplied = image.hasAlphaChannel();
+	QImage::Format format = premultiplied ?
+		QImage::Format_ARGB32_Premultiplied : QImage::Format_RGB32;
+	source = image.format() == format ? image : image.convertToFormat(format);
+	if(source.isNull() || !size.isValid() || size.isEmpty()) return;
+
+	result = QImage(size, format);
+	if(size.width() == source.width()) between = source;
+	else
+	{
+		between = QImage(size.width(), source.height(), format);
+		columnTaps = createWeights(
+			source.width(),
+			size.width(),
+			filter,
+			columnBounds,
+			columnWeights);
+	}
+
+	if(size.height() != source.height()) rowTaps = createWeights(
+		source.height(),
+		size.height(),
+		filter,
+		rowBounds,
+		rowWeights);
+}
+
+/**
+ * Function that computes the fixed-point weights of the filter for each
+ * target-position of a pass. When shrinking, the filter is stretched so it
+ * covers all source-pixels falling into a target-pixel.
+ * @param	from	The number of source-pixels.
+ * @param	to		The number of target-pixels.
+ * @param	filter	The filter.
+ * @param	bounds	Returns the first source-pixel and the number of
+ * 					source-pixels of each target-pixel.
+ * @param	weights	Returns the weights of each target-pixel, one row of as
+ * 					many weights as returned per target-pixel.
+ * @return	The number of weights per target-pixel.
+ */
+int PuMP_Resampler::createWeights(
+	int from,
+	int to,
+	Filter filter,
+	QVector<int> &bounds,
+	QVector<int> &weights)
+{
+	double ratio = (double)from / to;
+	double stretch = qMax(1.0, ratio);
+	double support = stretch;
+	if(filter == Area) support *= 0.5;
+	else if(filter == Lanczos) support *= 3;
+
+	int taps = (int)ceil(support) * 2 + 1;
+	bounds.resize(to * 2);
+	weights.fill(0, to * taps);
+	QVector<double> values(taps);
+
+	int i, k;
+	for(i = 0; i < to; i++)
+	{
+		double center = (i + 0.5) * ratio;
+		int left = qMax(0, (int)floor(center - support));
+		int right = qMin(from, (int)ceil(center + support));
+		int count = qMin(taps, right - left);
+
+		double total = 0;
+		int largest = 0;
+		for(k = 0; k < count; k++)
+		{
+			values[k] = kernel(filter, (left + k + 0.5 - center) / stretch);
+			total += values.at(k);
+			if(values.at(k) > values.at(largest)) largest = k;
+		}
+
+		// the rounding-error goes to the largest weight, so the weights
+		// always sum up to one
+		int *w = weights.data() + i * taps;
+		int sum = 0;
+		if(total == 0)
+		{
+			largest = qBound(0, (int)center - left, count - 1);
+			values[largest] = total = 1;
+		}
+		for(k = 0; k < count; k++)
+		{
+			w[k] = (int)floor(
+				values.at(k) / total * (1 << RESAMPLER_PRECISION) + 0.5);
+			sum += w[k];
+		}
+		w[largest] += (1 << RESAMPLER_PRECISION) - sum;
+
+		bounds[i * 2] = left;
+		bounds[i * 2 + 1] = count;
+	}
+	return taps;
+}
+
+/**
+ * Function that returns the resampled image. The passes are split into
+ * bands of lines, which are resampled in parallel.
+ * @return	The result, a null-image if the image couldn't be resampled or
+ * 			the resampling was cancelled.
+ */
+QImage PuMP_Resampler::image()
+{
+	if(result.isNull() || isCancelled()) return QImage();
+
+	// the targets are detached here, before the bands write into them
+	if(columnTaps > 0)
+	{
+		between.bits();
+		runBands(false, between.height());
+		if(isCancelled()) return QImage();
+	}
+	if(rowTaps == 0) return between;
+
+	result.bits();
+	runBands(true, result.height());
+	if(isCancelled()) return QImage();
+	return result;
+}
+
+/**
+ * Function that tells whether the resampling should stop.
+ * @return	True if the token given to the constructor was cancelled.
+ */
+bool PuMP_Resampler::isCancelled() const
+{
+	return token != NULL && token->isCancelled();
+}
+
+/**
+ * Function that returns the value of a filter.
+ * @param	filter	The filter.
+ * @param	x		The distance from the center, in target-pixels.
+ * @return	The value.
+ */
+double PuMP_Resampler::kernel(Filter filter, double x)
+{
+	if(x < 0) x = -x;
+	if(filter == Area) return x < 0.5 ? 1 : 0;
+	if(filter == Bilinear) return x < 1 ? 1 - x : 0;
+
+	if(x >= 3) return 0;
+	if(x < 1e-8) return 1;
+	double pix = M_PI * x;
+	return 3 * sin(pix) * sin(pix / 3) / (pix * pix);
+}
+
+/**
+ * Function that resamples the lines first to last to the new width.
+ * @param	first	The first line.
+ * @param	last	The line following the last one.
+ */
+void PuMP_Resampler::resampleColumns(int first, int last)
+{
+	const QImage &input = source;
+	const int *bounds = columnBounds.constData();
+	uchar *bits = between.bits();
+	int line = between.bytesPerLine();
+	int width = between.width();
+
+	int x, y, k;
+	for(y = first; y < last; y++)
+	{
+		if((y - first) % RESAMPLER_CHECK_LINES == 0 && isCancelled()) return;
+
+		const uchar *in = input.scanLine(y);
+		uchar *out = bits + y * line;
+		for(x = 0; x < width; x++, out += 4)
+		{
+			const uchar *p = in + bounds[x * 2] * 4;
+			const int *w = columnWeights.constData() + x * columnTaps;
+			int count = bounds[x * 2 + 1];
+
+			int c0, c1, c2, c3;
+			c0 = c1 = c2 = c3 = 1 << (RESAMPLER_PRECISION - 1);
+			for(k = 0; k < count; k++, p += 4)
+			{
+				c0 += p[0] * w[k];
+				c1 += p[1] * w[k];
+				c2 += p[2] * w[k];
+				c3 += p[3] * w[k];
+			}
+			out[0] = toChannel(c0);
+			out[1] = toChannel(c1);
+			out[2] = toChannel(c2);
+			out[3] = toChannel(c3);
+			if(premultiplied) limitToAlpha(*(QRgb *)out);
+		}
+	}
+}
+
+/**
+ * Function that resamples the lines first to last of the result from the
+ * lines of the first pass. The lines contributing to a line are added up
+ * one after another, so the source is read along its lines.
+ * @param	first	The first line.
+ * @param	last	The line following the last one.
+ */
+void PuMP_Resampler::resampleRows(int first, int last)
+{
+	const QImage &input = between;
+	const int *bounds = rowBounds.constData();
+	uchar *bits = result.bits();
+	int line = result.bytesPerLine();
+	int size = result.width() * 4;
+	QVector<int> sums(size);
+	int *s = sums.data();
+
+	int i, y, k;
+	for(y = first; y < last; y++)
+	{
+		if((y - first) % RESAMPLER_CHECK_LINES == 0 && isCancelled()) return;
+
+		const int *w = rowWeights.constData() + y * rowTaps;
+		int top = bounds[y * 2];
+		int count = bounds[y * 2 + 1];
+
+		for(i = 0; i < size; i++) s[i] = 1 << (RESAMPLER_PRECISION - 1);
+		for(k = 0; k < count; k++)
+		{
+			const uchar *in = input.scanLine(top + k);
+			int weight = w[k];
+			for(i = 0; i < size; i++) s[i] += in[i] * weight;
+		}
+
+		uchar *out = bits + y * line;
+		for(i = 0; i < size; i++) out[i] = toChannel(s[i]);
+		if(premultiplied)
+		{
+			QRgb *pixels = (QRgb *)out;
+			for(i = 0; i < size / 4; i++) limitToAlpha(pixels[i]);
+		}
+	}
+}
+
+/**
+ * Function that runs a pass in bands of lines. Small images aren't worth the
+ * threads, the first band is resampled by the calling thread itself.
+ * @param	vertical	True for the vertical pass, false for the horizontal
+ * 						one.
+ * @param	lines		The number of lines of the pass.
+ */
+void PuMP_Resampler::runBands(bool vertical, int lines)
+{
+	int count = threads;
+	if(result.width() * result.height() < RESAMPLER_MIN_PIXELS &&
+		source.width() * source.height() < RESAMPLER_MIN_PIXELS) count = 1;
+	count = qMax(1, qMin(count, lines));
+	int band = (lines + count - 1) / count;
+
+	QList<PuMP_ResamplerBand *> bands;
+	int i;
+	for(i = 0; i < count; i++)
+		bands.append(new PuMP_ResamplerBand(
+			this,
+			vertical,
+			qMin(i * band, lines),
+			qMin((i + 1) * band, lines)));
+
+	for(i = 1; i < bands.size(); i++) bands.at(i)->start();
+	bands.first()->run();
+	for(i = 0; i < bands.size(); i++)
+	{
+		bands.at(i)->wait();
+		delete bands.at(i);
+	}
+}
+
+/**
+ * Function that resamples an image to the given size.
+ * @param	image	The image to resample.
+ * @param	size	The size of the result.
+ * @param	filter	The filter: Area averages all source-pixels covered by a
+ * 					target-pixel and suits shrinking, Bilinear is the
+ * 					fastest, Lanczos the sharpest.
+ * @param	threads	The number of threads to use, 0 to use one per
+ * 					processor.
+ * @param	token	If given, the resampling stops as soon as it is
+ * 					cancelled.
+ * @return	The resampled image, in 32-bit format, premultiplied if the
+ * 			image has an alpha-channel; a null-image if it was cancelled.
+ */
+QImage PuMP_Resampler::scale(
+	const QImage &image,
+	const QSize &size,
+	Filter filter,
+	int threads,
+	const PuMP_CancelToken *token)
+{
+	if(image.size() == size) return image;
+
+	PuMP_Resampler resampler(image, size, filter, threads, token);
+	return resampler.image();
+}
+
+/*****************************************************************************/
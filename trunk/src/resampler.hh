@@ -0,0 +1,120 @@
+/*
+ * Copyright 2007 Christoph Werle, Tobias Schlager
+ * 
+ * This file is part of "PuMP - Publish My Pictures".
+ *
+ * "Publish My Pictures" is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * "Publish My Pictures" is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with "Publish My Pictures"; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ */
+
+#ifndef RESAMPLER_HH_
+#define RESAMPLER_HH_
+
+#include <QImage>
+#include <QSize>
+#include <QThread>
+#include <QVector>
+
+#include "cancelToken.hh"
+
+/******************************************************************************/
+
+#define RESAMPLER_PRECISION		14
+#define RESAMPLER_MIN_PIXELS	(512 * 512)
+#define RESAMPLER_CHECK_LINES	16
+
+/******************************************************************************/
+
+class PuMP_Resampler;
+
+class PuMP_ResamplerBand : public QThread
+{
+	protected:
+		bool vertical;
+		int first;
+		int last;
+		PuMP_Resampler *resampler;
+
+	public:
+		PuMP_ResamplerBand(
+			PuMP_Resampler *resampler,
+			bool vertical,
+			int first,
+			int last);
+
+		void run();
+};
+
+/******************************************************************************/
+
+class PuMP_Resampler
+{
+	public:
+		enum Filter
+		{
+			Area,
+			Bilinear,
+			Lanczos
+		};
+
+	protected:
+		bool premultiplied;
+		int columnTaps;
+		int rowTaps;
+		int threads;
+		QImage source;
+		QImage between;
+		QImage result;
+		const PuMP_CancelToken *token;
+
+		QVector<int> columnBounds;
+		QVector<int> columnWeights;
+		QVector<int> rowBounds;
+		QVector<int> rowWeights;
+
+		static int createWeights(
+			int from,
+			int to,
+			Filter filter,
+			QVector<int> &bounds,
+			QVector<int> &weights);
+		static double kernel(Filter filter, double x);
+
+		void runBands(bool vertical, int lines);
+
+	public:
+		PuMP_Resampler(
+			const QImage &image,
+			const QSize &size,
+			Filter filter,
+			int threads,
+			const PuMP_CancelToken *token = 0);
+
+		bool isCancelled() const;
+		void resampleColumns(int first, int last);
+		void resampleRows(int first, int last);
+		QImage image();
+
+		static QImage scale(
+			const QImage &image,
+			const QSize &size,
+			Filter filter = Area,
+			int threads = 0,
+			const PuMP_CancelToken *token = 0);
+};
+
+/******************************************************************************/
+
+#endif /*RESAMPLER_HH_*/
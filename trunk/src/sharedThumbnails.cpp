@@ -0,0 +1,214 @@
+/*
+ * Copyright 2007 Christoph Werle, Tobias Schlager
+ * 
+ * This file is part of "PuMP - Publish My Pictures".
+ *
+ * "Publish My Pictures" is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * "Publish My Pictures" is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with "Publish My Pictures"; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ */
+
+#include <stdlib.h>
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QUrl>
+
+#include "sharedThumbnails.hh"
+
+/*****************************************************************************/
+
+/**
+ * Function that returns the directories shared thumbnails are kept in, as
+ * defined by the freedesktop.org thumbnail specification. The first one is
+ * the current location, the second the one used by older applications.
+ * @return	The directories.
+ */
+QStringList PuMP_SharedThumbnails::getDirectories()
+{
+	QString cache = QFile::decodeName(getenv("XDG_CACHE_HOME"));
+	if(cache.isEmpty()) cache = QDir::homePath() + "/.cache";
+
+	QStringList dirs;
+	dirs.append(cache + "/" + SHARED_THUMBNAILS_DIR);
+	dirs.append(QDir::homePath() + "/" + SHARED_THUMBNAILS_LEGACY_DIR);
+	return dirs;
+}
+
+/**
+ * Function that returns the file-name of the thumbnail of a file, which is
+ * the MD5-sum of its URI.
+ * @param	uri	The URI of the file.
+ * @return	The file-name of the thumbnail.
+ */
+QString PuMP_SharedThumbnails::getFileName(const QByteArray &uri)
+{
+	return QString(
+		QCryptographicHash::hash(uri, QCryptographicHash::Md5).toHex()) +
+		".png";
+}
+
+/**
+ * Function that returns the URI of a file as used by the specification.
+ * @param	info	The file.
+ * @return	The URI, with reserved characters escaped.
+ */
+QByteArray PuMP_SharedThumbnails::getUri(const QFileInfo &info)
+{
+	return QUrl::fromLocalFile(info.absoluteFilePath()).toEncoded();
+}
+
+/**
+ * Function that reads a shared thumbnail and checks whether it belongs to
+ * the given file and is up to date.
+ * @param	path		The path of the thumbnail.
+ * @param	info		The file the thumbnail was made for.
+ * @param	uri			The URI of the file.
+ * @param	thumbnail	Returns the thumbnail.
+ * @param	imageSize	Returns the dimensions of the original image, or an
+ * 						invalid size if the thumbnail doesn't tell them.
+ * @return	True if the thumbnail is valid, false otherwise.
+ */
+bool PuMP_SharedThumbnails::read(
+	const QString &path,
+	const QFileInfo &info,
+	const QByteArray &uri,
+	QImage &thumbnail,
+	QSize &imageSize)
+{
+	if(!QFile::exists(path) || !thumbnail.load(path, "PNG")) return false;
+
+	bool ok;
+	uint mtime = thumbnail.text("Thumb::MTime").toUInt(&ok);
+	if(!ok || mtime != info.lastModified().toTime_t() ||
+		thumbnail.text("Thumb::URI") != QString::fromLatin1(uri.constData()))
+	{
+		thumbnail = QImage();
+		return false;
+	}
+
+	imageSize = QSize(
+		thumbnail.text("Thumb::Image::Width").toInt(),
+		thumbnail.text("Thumb::Image::Height").toInt());
+	return true;
+}
+
+/**
+ * Function that looks for a valid thumbnail of the given file, which another
+ * application created in the shared directories. The large thumbnail is
+ * preferred.
+ * @param	info		The file.
+ * @param	thumbnail	Returns the thumbnail.
+ * @param	imageSize	Returns the dimensions of the original image, or an
+ * 						invalid size if the thumbnail doesn't tell them.
+ * @return	True if a thumbnail was found, false otherwise.
+ */
+bool PuMP_SharedThumbnails::lookup(
+	const QFileInfo &info,
+	QImage &thumbnail,
+	QSize &imageSize)
+{
+	QByteArray uri = getUri(info);
+	QString name = getFileName(uri);
+	QStringList dirs = getDirectories();
+
+	int i;
+	for(i = 0; i < dirs.size(); i++)
+	{
+		QString dir = dirs.at(i) + "/";
+		if(read(
+			dir + SHARED_THUMBNAILS_LARGE + "/" + name,
+			info,
+			uri,
+			thumbnail,
+			imageSize)) return true;
+		if(read(
+			dir + SHARED_THUMBNAILS_NORMAL + "/" + name,
+			info,
+			uri,
+			thumbnail,
+			imageSize)) return true;
+	}
+	return false;
+}
+
+/**
+ * Function that writes a thumbnail to the shared directory, so other
+ * applications can use it. Thumbnails fitting into 128 pixels are stored as
+ * normal, those fitting into 256 pixels as large ones, larger ones aren't
+ * stored at all.
+ * @param	info		The file the thumbnail was made for.
+ * @param	thumbnail	The thumbnail.
+ * @param	imageSize	The dimensions of the original image.
+ * @return	True on success, false otherwise.
+ */
+bool PuMP_SharedThumbnails::store(
+	const QFileInfo &info,
+	const QImage &thumbnail,
+	const QSize &imageSize)
+{
+	int size = qMax(thumbnail.width(), thumbnail.height());
+	const char *flavour = SHARED_THUMBNAILS_NORMAL;
+	if(size > SHARED_THUMBNAILS_LARGE_SIZE) return false;
+	else if(size > SHARED_THUMBNAILS_NORMAL_SIZE)
+		flavour = SHARED_THUMBNAILS_LARGE;
+
+	// thumbnails of thumbnails are never created
+	QString base = getDirectories().first();
+	if(info.absoluteFilePath().startsWith(base)) return false;
+
+	QDir dir(base + "/" + flavour);
+	if(!dir.exists() && !dir.mkpath(dir.path())) return false;
+	QFile::setPermissions(base, QFile::ReadOwner | QFile::WriteOwner |
+		QFile::ExeOwner);
+	QFile::setPermissions(dir.path(), QFile::ReadOwner | QFile::WriteOwner |
+		QFile::ExeOwner);
+
+	QByteArray uri = getUri(info);
+	QImage image = thumbnail;
+	image.setText("Thumb::URI", QString::fromLatin1(uri.constData()));
+	image.setText(
+		"Thumb::MTime",
+		QString::number(info.lastModified().toTime_t()));
+	image.setText("Thumb::Size", QString::number(info.size()));
+	image.setText("Thumb::Image::Width", QString::number(imageSize.width()));
+	image.setText(
+		"Thumb::Image::Height",
+		QString::number(imageSize.height()));
+	image.setText("Software", "PuMP - Publish My Pictures");
+
+	// written under a temporary name, so readers never see a partial file
+	QString path = dir.absoluteFilePath(getFileName(uri));
+	QFile file(path + SHARED_THUMBNAILS_TMP);
+	if(!file.open(QIODevice::WriteOnly)) return false;
+	file.setPermissions(QFile::ReadOwner | QFile::WriteOwner);
+	if(!image.save(&file, "PNG"))
+	{
+		file.remove();
+		return false;
+	}
+	file.close();
+
+	QFile::remove(path);
+	if(!file.rename(path))
+	{
+		file.remove();
+		return false;
+	}
+	return true;
+}
+
+/*****************************************************************************/
@@ -0,0 +1,70 @@
+/*
+ * Copyright 2007 Christoph Werle, Tobias Schlager
+ * 
+ * This file is part of "PuMP - Publish My Pictures".
+ *
+ * "Publish My Pictures" is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * "Publish My Pictures" is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with "Publish My Pictures"; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ */
+
+#ifndef SHAREDTHUMBNAILS_HH_
+#define SHAREDTHUMBNAILS_HH_
+
+#include <QByteArray>
+#include <QFileInfo>
+#include <QImage>
+#include <QSize>
+#include <QString>
+#include <QStringList>
+
+/******************************************************************************/
+
+#define SHARED_THUMBNAILS_DIR			"thumbnails"
+#define SHARED_THUMBNAILS_LEGACY_DIR	".thumbnails"
+#define SHARED_THUMBNAILS_NORMAL		"normal"
+#define SHARED_THUMBNAILS_NORMAL_SIZE	128
+#define SHARED_THUMBNAILS_LARGE			"large"
+#define SHARED_THUMBNAILS_LARGE_SIZE	256
+#define SHARED_THUMBNAILS_TMP			".tmp"
+
+/******************************************************************************/
+
+class PuMP_SharedThumbnails
+{
+	protected:
+		static QStringList getDirectories();
+		static QString getFileName(const QByteArray &uri);
+		static QByteArray getUri(const QFileInfo &info);
+		static bool read(
+			const QString &path,
+			const QFileInfo &info,
+			const QByteArray &uri,
+			QImage &thumbnail,
+			QSize &imageSize);
+
+	public:
+		static bool lookup(
+			const QFileInfo &info,
+			QImage &thumbnail,
+			QSize &imageSize);
+		static bool store(
+			const QFileInfo &info,
+			const QImage &thumbnail,
+			const QSize &imageSize);
+};
+
+/******************************************************************************/
+
+#endif /*SHAREDTHUMBNAILS_HH_*/
@@ -0,0 +1,389 @@
+/*
+ * Copyright 2007 Christoph Werle, Tobias Schlager
+ * 
+ * This file is part of "PuMP - Publish My Pictures".
+ *
+ * "Publish My Pictures" is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * "Publish My Pictures" is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with "Publish My Pictures"; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ */
+
+#include <QDir>
+#include <QMutexLocker>
+#include <QtAlgorithms>
+
+#include "mainWindow.hh"
+#include "siblingIndex.hh"
+
+/*****************************************************************************/
+
+/**
+ * Function that renews the positions of the names from the given one on,
+ * after names were inserted or removed there.
+ * @param	first	The first position that changed.
+ */
+void PuMP_SiblingList::updateRows(int first)
+{
+	int i;
+	for(i = qMax(0, first); i < names.size(); i++) rows.insert(names.at(i), i);
+}
+
+/*****************************************************************************/
+
+/**
+ * Constructor of class PuMP_SiblingReader, a thread that lists the
+ * directories of the index again after they changed, so the thread using
+ * the index never waits for the file-system.
+ * @param	index	The index the listings are handed to.
+ */
+PuMP_SiblingReader::PuMP_SiblingReader(PuMP_SiblingIndex *index)
+{
+	this->index = index;
+	shutdown = false;
+}
+
+/**
+ * Destructor of class PuMP_SiblingReader, which stops the thread.
+ */
+PuMP_SiblingReader::~PuMP_SiblingReader()
+{
+	mutex.lock();
+	shutdown = true;
+	queue.clear();
+	condition.wakeAll();
+	mutex.unlock();
+	wait();
+}
+
+/**
+ * Function that queues a directory to be listed again.
+ * @param	path	The absolute path of the directory.
+ */
+void PuMP_SiblingReader::read(const QString &path)
+{
+	QMutexLocker locker(&mutex);
+	if(!queue.contains(path)) queue.append(path);
+	condition.wakeAll();
+
+	if(!isRunning()) start(QThread::LowPriority);
+}
+
+/**
+ * The overloaded main-function of this thread. The queued directories are
+ * listed one after another.
+ */
+void PuMP_SiblingReader::run()
+{
+	mutex.lock();
+	while(!shutdown)
+	{
+		if(queue.isEmpty())
+		{
+			condition.wait(&mutex);
+			continue;
+		}
+
+		QString path = queue.takeFirst();
+		mutex.unlock();
+		index->renewEntries(path, PuMP_SiblingIndex::list(path));
+		mutex.lock();
+	}
+	mutex.unlock();
+}
+
+/*****************************************************************************/
+
+/**
+ * Constructor of class PuMP_SiblingIndex, which keeps the sorted image-files
+ * of the SIBLING_INDEX_SIZE directories used last, so the image-views find
+ * the neighbours of an image without listing its directory. The lists are
+ * sorted like the overview sorts them; the overview hands its listings and
+ * the changes it found over, all other directories are listed on first use
+ * (by the reader, if the GUI-thread asks).
+ * Changed directories are listed again by a thread of their own, meanwhile
+ * their old lists are used. The index may be used from any thread.
+ * @param	parent	The parent of this class.
+ */
+PuMP_SiblingIndex::PuMP_SiblingIndex(QObject *parent) : QObject(parent)
+{
+	// the watcher lives in the thread of the index, paths are added and
+	// removed there
+	watcher.setParent(this);
+	connect(
+		&watcher,
+		SIGNAL(directoryChanged(const QString &)),
+		this,
+		SLOT(on_watcher_directoryChanged(const QString &)));
+	connect(
+		this,
+		SIGNAL(watch(const QString &)),
+		this,
+		SLOT(on_watch(const QString &)),
+		Qt::QueuedConnection);
+	connect(
+		this,
+		SIGNAL(unwatch(const QString &)),
+		this,
+		SLOT(on_unwatch(const QString &)),
+		Qt::QueuedConnection);
+
+	reader = new PuMP_SiblingReader(this);
+}
+
+/**
+ * Destructor of class PuMP_SiblingIndex, which stops the reader.
+ */
+PuMP_SiblingIndex::~PuMP_SiblingIndex()
+{
+	delete reader;
+}
+
+/**
+ * Function that inserts image-files into the sorted list of a directory,
+ * e.g. the ones the overview found while rescanning it. Directories that
+ * aren't indexed are ignored.
+ * @param	path	The absolute path of the directory.
+ * @param	names	The file-names of the new images.
+ */
+void PuMP_SiblingIndex::addEntries(
+	const QString &path,
+	const QStringList &names)
+{
+	QMutexLocker locker(&mutex);
+	if(!lists.contains(path)) return;
+
+	PuMP_SiblingList &list = lists[path];
+	int first = list.names.size();
+	int i;
+	for(i = 0; i < names.size(); i++)
+	{
+		if(list.rows.contains(names.at(i))) continue;
+
+		QStringList::iterator it = qLowerBound(
+			list.names.begin(),
+			list.names.end(),
+			names.at(i));
+		int row = it - list.names.begin();
+		list.names.insert(row, names.at(i));
+		first = qMin(first, row);
+	}
+	list.updateRows(first);
+}
+
+/**
+ * Function that returns the position of an image among its siblings.
+ * @param	info	The image-file.
+ * @param	count	If given, returns the number of siblings.
+ * @return	The position, -1 if the image isn't listed.
+ */
+int PuMP_SiblingIndex::getRow(const QFileInfo &info, int *count)
+{
+	QString path = info.absolutePath();
+	update(path);
+
+	QMutexLocker locker(&mutex);
+	PuMP_SiblingList list = lists.value(path);
+	if(count != NULL) *count = list.names.size();
+	return list.rows.value(info.fileName(), -1);
+}
+
+/**
+ * Function that returns a sibling of an image.
+ * @param	info	The image-file.
+ * @param	offset	The distance to the sibling, negative for the previous
+ * 					ones.
+ * @return	The sibling, an empty file-info-object if there is none.
+ */
+QFileInfo PuMP_SiblingIndex::getSibling(const QFileInfo &info, int offset)
+{
+	QString path = info.absolutePath();
+	update(path);
+
+	QMutexLocker locker(&mutex);
+	PuMP_SiblingList list = lists.value(path);
+	int row = list.rows.value(info.fileName(), -1);
+	if(row < 0 || row + offset < 0 || row + offset >= list.names.size())
+		return QFileInfo();
+	return QFileInfo(QDir(path), list.names.at(row + offset));
+}
+
+/**
+ * Function that lists the image-files of a directory, sorted.
+ * @param	path	The absolute path of the directory.
+ * @return	The file-names of the images.
+ */
+QStringList PuMP_SiblingIndex::list(const QString &path)
+{
+	QStringList names = QDir(path).entryList(
+		PuMP_MainWindow::nameFilters,
+		QDir::Files);
+	qSort(names.begin(), names.end());
+	return names;
+}
+
+/**
+ * Function that removes image-files from the sorted list of a directory,
+ * e.g. the ones the overview missed while rescanning it.
+ * @param	path	The absolute path of the directory.
+ * @param	names	The file-names of the removed images.
+ */
+void PuMP_SiblingIndex::removeEntries(
+	const QString &path,
+	const QStringList &names)
+{
+	QMutexLocker locker(&mutex);
+	if(!lists.contains(path)) return;
+
+	PuMP_SiblingList &list = lists[path];
+	int first = list.names.size();
+	int i;
+	for(i = 0; i < names.size(); i++)
+	{
+		int row = list.rows.value(names.at(i), -1);
+		if(row < 0) continue;
+
+		list.rows.remove(names.at(i));
+		first = qMin(first, row);
+	}
+
+	// the names are taken out in one pass behind the first removed one
+	for(i = list.names.size() - 1; i >= first; i--)
+		if(!list.rows.contains(list.names.at(i))) list.names.removeAt(i);
+	list.updateRows(first);
+}
+
+/**
+ * Function that replaces the list of a directory by a new listing, unless
+ * the directory was dropped from the index meanwhile. Directories the
+ * GUI-thread missed are added to the index, see update().
+ * @param	path	The absolute path of the directory.
+ * @param	names	The file-names of the images, sorted.
+ */
+void PuMP_SiblingIndex::renewEntries(
+	const QString &path,
+	const QStringList &names)
+{
+	mutex.lock();
+	bool requested = pending.removeAll(path) > 0;
+	bool indexed = lists.contains(path);
+	if(indexed)
+	{
+		PuMP_SiblingList list;
+		list.names = names;
+		list.updateRows(0);
+		lists.insert(path, list);
+	}
+	mutex.unlock();
+
+	if(!requested) return;
+	if(!indexed) setEntries(path, names);
+	emit listed(path);
+}
+
+/**
+ * Function that sets the image-files of a directory, e.g. from a listing
+ * the overview did anyway. The directory used longest ago is dropped if the
+ * index is full.
+ * @param	path	The absolute path of the directory.
+ * @param	names	The file-names of the images, sorted.
+ */
+void PuMP_SiblingIndex::setEntries(
+	const QString &path,
+	const QStringList &names)
+{
+	QMutexLocker locker(&mutex);
+	PuMP_SiblingList list;
+	list.names = names;
+	list.updateRows(0);
+
+	if(!lists.contains(path)) emit watch(path);
+	lists.insert(path, list);
+	recent.removeAll(path);
+	recent.prepend(path);
+
+	while(recent.size() > SIBLING_INDEX_SIZE)
+	{
+		QString old = recent.takeLast();
+		lists.remove(old);
+		emit unwatch(old);
+	}
+}
+
+/**
+ * Function that lists a directory unless it is indexed already. The
+ * GUI-thread doesn't wait for the file-system, the directory is listed by
+ * the reader and has no siblings until listed() is emitted.
+ * @param	path	The absolute path of the directory.
+ */
+void PuMP_SiblingIndex::update(const QString &path)
+{
+	mutex.lock();
+	bool valid = lists.contains(path);
+	if(valid)
+	{
+		recent.removeAll(path);
+		recent.prepend(path);
+	}
+	else if(QThread::currentThread() == thread())
+	{
+		if(!pending.contains(path))
+		{
+			pending.append(path);
+			reader->read(path);
+		}
+		valid = true;
+	}
+	mutex.unlock();
+	if(valid) return;
+
+	// the directory is listed without holding the lock, so the other
+	// directories stay available meanwhile
+	setEntries(path, list(path));
+}
+
+/**
+ * Slot-function that stops watching a directory dropped from the index.
+ * @param	path	The directory.
+ */
+void PuMP_SiblingIndex::on_unwatch(const QString &path)
+{
+	QMutexLocker locker(&mutex);
+	if(!lists.contains(path)) watcher.removePath(path);
+}
+
+/**
+ * Slot-function that starts watching a directory added to the index.
+ * @param	path	The directory.
+ */
+void PuMP_SiblingIndex::on_watch(const QString &path)
+{
+	QMutexLocker locker(&mutex);
+	if(lists.contains(path) && !watcher.directories().contains(path))
+		watcher.addPath(path);
+}
+
+/**
+ * Slot-function that is called when a watched directory changed. It is
+ * listed again by the reader, the old list is used until then.
+ * @param	path	The directory.
+ */
+void PuMP_SiblingIndex::on_watcher_directoryChanged(const QString &path)
+{
+	mutex.lock();
+	bool indexed = lists.contains(path);
+	mutex.unlock();
+	if(indexed) reader->read(path);
+}
+
+/*****************************************************************************/
@@ -0,0 +1,113 @@
+/*
+ * Copyright 2007 Christoph Werle, Tobias Schlager
+ * 
+ * This file is part of "PuMP - Publish My Pictures".
+ *
+ * "Publish My Pictures" is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * "Publish My Pictures" is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with "Publish My Pictures"; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ */
+
+#ifndef SIBLINGINDEX_HH_
+#define SIBLINGINDEX_HH_
+
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QThread>
+#include <QWaitCondition>
+
+/******************************************************************************/
+
+#define SIBLING_INDEX_SIZE	16
+
+/******************************************************************************/
+
+class PuMP_SiblingList
+{
+	public:
+		QStringList names;
+		QHash<QString, int> rows;
+
+		void updateRows(int first);
+};
+
+/******************************************************************************/
+
+class PuMP_SiblingIndex;
+
+class PuMP_SiblingReader : public QThread
+{
+	protected:
+		bool shutdown;
+		QStringList queue;
+		PuMP_SiblingIndex *index;
+		QMutex mutex;
+		QWaitCondition condition;
+
+		void run();
+
+	public:
+		PuMP_SiblingReader(PuMP_SiblingIndex *index);
+		~PuMP_SiblingReader();
+
+		void read(const QString &path);
+};
+
+/******************************************************************************/
+
+class PuMP_SiblingIndex : public QObject
+{
+	Q_OBJECT
+
+	protected:
+		QHash<QString, PuMP_SiblingList> lists;
+		QStringList pending;
+		QStringList recent;
+		QFileSystemWatcher watcher;
+		QMutex mutex;
+		PuMP_SiblingReader *reader;
+
+		void update(const QString &path);
+
+	public:
+		PuMP_SiblingIndex(QObject *parent = 0);
+		~PuMP_SiblingIndex();
+
+		void addEntries(const QString &path, const QStringList &names);
+		int getRow(const QFileInfo &info, int *count = NULL);
+		QFileInfo getSibling(const QFileInfo &info, int offset);
+		static QStringList list(const QString &path);
+		void removeEntries(const QString &path, const QStringList &names);
+		void renewEntries(const QString &path, const QStringList &names);
+		void setEntries(const QString &path, const QStringList &names);
+
+	signals:
+		void listed(const QString &path);
+		void unwatch(const QString &path);
+		void watch(const QString &path);
+
+	public slots:
+		void on_unwatch(const QString &path);
+		void on_watch(const QString &path);
+		void on_watcher_directoryChanged(const QString &path);
+};
+
+/******************************************************************************/
+
+#endif /*SIBLINGINDEX_HH_*/
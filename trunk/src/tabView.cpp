@@ -29,6 +29,7 @@
 #include "imageView.hh"
 #include "mainWindow.hh"
 #include "overview.hh"
+#include "siblingIndex.hh"
 #include "tabView.hh"
 
 /*****************************************************************************/
@@ -64,6 +65,12 @@ PuMP_TabView::PuMP_TabView(QWidget *parent)	: QTabWidget(parent)
 		SIGNAL(currentChanged(int)),
 		this,
 		SLOT(on_currentChanged(int)));
+	if(PuMP_MainWindow::siblingIndex != NULL)
+		connect(
+			PuMP_MainWindow::siblingIndex,
+			SIGNAL(listed(const QString &)),
+			this,
+			SLOT(on_siblingIndex_listed(const QString &)));
 
 	connect(
 		PuMP_MainWindow::closeAction,
@@ -257,6 +264,15 @@ void PuMP_TabView::on_error(PuMP_ImageView *view)
 	}
 }
 
+/**
+ * Slot-function that passes the directory-history on to the overview.
+ * @param	paths	The paths of the recently visited directories.
+ */
+void PuMP_TabView::on_historyChanged(const QStringList &paths)
+{
+	overview->setHistory(paths);
+}
+
 /**
  * Slot-function that is a wrapper for the on_currentChanged-slot that can be
  * called without arguments.
@@ -487,6 +503,18 @@ void PuMP_TabView::on_setActions(PuMP_ImageView *view)
 	}
 }
 
+/**
+ * Slot-function that is called when the sibling-index listed a directory it
+ * didn't know yet. The current image may have a predecessor or successor
+ * now, so the actions are set up again.
+ * @param	path	The listed directory.
+ */
+void PuMP_TabView::on_siblingIndex_listed(const QString &path)
+{
+	Q_UNUSED(path);
+	on_currentChanged(currentIndex());
+}
+
 /**
  * Slot-function that shows the current image in original size.
  */
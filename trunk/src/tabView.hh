@@ -26,6 +26,7 @@
 #include <QFileInfo>
 #include <QMap>
 #include <QString>
+#include <QStringList>
 #include <QTabWidget>
 
 /*****************************************************************************/
@@ -58,6 +59,7 @@ class PuMP_TabView : public QTabWidget
 		void on_closeAction_triggered();
 		void on_currentChanged(int index); 
 		void on_error(PuMP_ImageView *view = NULL);
+		void on_historyChanged(const QStringList &paths);
 		void on_imageView_processingFinished();
 		void on_mirrorHAction();
 		void on_mirrorVAction();
@@ -69,6 +71,7 @@ class PuMP_TabView : public QTabWidget
 		void on_saveAction();
 		void on_saveAsAction();
 		void on_setActions(PuMP_ImageView *view = NULL);
+		void on_siblingIndex_listed(const QString &path);
 		void on_sizeOriginalAction();
 		void on_sizeFittedAction();
 		void on_zoomInAction();
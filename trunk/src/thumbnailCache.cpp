@@ -0,0 +1,737 @@
+/*
+ * Copyright 2007 Christoph Werle, Tobias Schlager
+ * 
+ * This file is part of "PuMP - Publish My Pictures".
+ *
+ * "Publish My Pictures" is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * "Publish My Pictures" is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with "Publish My Pictures"; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ */
+
+#include <assert.h>
+#include <string.h>
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QDebug>
+#include <QList>
+#include <QMutexLocker>
+#include <QPair>
+#include <QStringList>
+
+#include "mainWindow.hh"
+#include "thumbnailCache.hh"
+
+extern "C" {
+	#include "src/zlib/zlib.h"
+}
+
+/** size of the header preceding every record in the data-file */
+#define RECORD_HEADER	12
+/** records larger than this are considered corrupt */
+#define RECORD_MAX		(4 * 1024 * 1024)
+
+/*****************************************************************************/
+
+/**
+ * Constructor of class PuMP_ThumbnailCacheEntry, which describes where a
+ * cached thumbnail is located in the data-file and which version of the
+ * original file it was made from.
+ */
+PuMP_ThumbnailCacheEntry::PuMP_ThumbnailCacheEntry()
+{
+	offset = 0;
+	length = 0;
+	mtime = 0;
+	size = 0;
+	lastUsed = 0;
+}
+
+/*****************************************************************************/
+
+/**
+ * Constructor of class PuMP_ThumbnailCollector, a thread that runs the
+ * garbage-collection of a thumbnail-cache in the background.
+ * @param	cache	The cache to collect.
+ */
+PuMP_ThumbnailCollector::PuMP_ThumbnailCollector(PuMP_ThumbnailCache *cache)
+{
+	this->cache = cache;
+}
+
+/**
+ * The overloaded main-function of this thread.
+ */
+void PuMP_ThumbnailCollector::run()
+{
+	cache->collectGarbage();
+}
+
+/*****************************************************************************/
+
+/**
+ * Constructor of class PuMP_ThumbnailCache. The cache persists thumbnails in
+ * an append-only data-file and keeps an index of all records in memory. The
+ * index is written back on destruction, records appended after the last
+ * index-write are recovered by scanning the tail of the data-file. If the
+ * last garbage-collection is too long ago, one is started in the background.
+ */
+PuMP_ThumbnailCache::PuMP_ThumbnailCache() : PuMP_SettingsInterface()
+{
+	compacting = false;
+	valid = false;
+	clock = 0;
+	liveBytes = 0;
+	maxBytes = THUMBNAIL_CACHE_MAXSIZE * 1024 * 1024;
+	lastGC = 0;
+	collector = NULL;
+
+	loadSettings();
+
+	QMutexLocker locker(&mutex);
+	valid = open();
+	if(!valid) qDebug() << "thumbnail-cache disabled";
+	locker.unlock();
+
+	uint now = QDateTime::currentDateTime().toTime_t();
+	if(valid && now - lastGC > THUMBNAIL_CACHE_GC_DAYS * 24 * 3600)
+	{
+		collector = new PuMP_ThumbnailCollector(this);
+		collector->start(QThread::LowestPriority);
+	}
+}
+
+/**
+ * Destructor of class PuMP_ThumbnailCache that stops a running
+ * garbage-collection and writes the index back to disk.
+ */
+PuMP_ThumbnailCache::~PuMP_ThumbnailCache()
+{
+	closing.cancel();
+	if(collector != NULL)
+	{
+		collector->wait();
+		delete collector;
+	}
+
+	QMutexLocker locker(&mutex);
+	if(valid)
+	{
+		writeIndex();
+		data.close();
+	}
+	locker.unlock();
+
+	storeSettings();
+}
+
+/**
+ * Function that loads the formerly stored settings for this class.
+ */
+void PuMP_ThumbnailCache::loadSettings()
+{
+	int mbytes = PuMP_MainWindow::settings->value(
+		PUMP_THUMBNAILCACHE_MAXSIZE,
+		THUMBNAIL_CACHE_MAXSIZE).toInt();
+	if(mbytes < 1) mbytes = 1;
+
+	maxBytes = ((qint64) mbytes) * 1024 * 1024;
+	lastGC = PuMP_MainWindow::settings->value(
+		PUMP_THUMBNAILCACHE_LASTGC,
+		0).toUInt();
+}
+
+/**
+ * Function that stores all settings for this class.
+ */
+void PuMP_ThumbnailCache::storeSettings()
+{
+	PuMP_MainWindow::settings->setValue(
+		PUMP_THUMBNAILCACHE_MAXSIZE,
+		(int)(maxBytes / (1024 * 1024)));
+	PuMP_MainWindow::settings->setValue(PUMP_THUMBNAILCACHE_LASTGC, lastGC);
+}
+
+/**
+ * Function that opens the data-file and rebuilds the in-memory index. Left
+ * overs of an interrupted compaction are cleaned up first.
+ * @return	True if the cache is usable, false otherwise.
+ */
+bool PuMP_ThumbnailCache::open()
+{
+	dir.setPath(QDir::homePath());
+	if(!dir.exists(THUMBNAIL_CACHE_DIR) && !dir.mkdir(THUMBNAIL_CACHE_DIR))
+		return false;
+	if(!dir.cd(THUMBNAIL_CACHE_DIR)) return false;
+
+	QString dataPath = dir.absoluteFilePath(THUMBNAIL_CACHE_DATA);
+	QString tmpPath = dataPath + THUMBNAIL_CACHE_TMP;
+	if(QFile::exists(tmpPath))
+	{
+		// the data-file is only removed after its successor was written
+		// completely, so a temporary file next to it is incomplete
+		if(QFile::exists(dataPath)) QFile::remove(tmpPath);
+		else QFile::rename(tmpPath, dataPath);
+	}
+
+	data.setFileName(dataPath);
+	if(!data.open(QIODevice::ReadWrite)) return false;
+
+	qint64 covered = 0;
+	if(!readIndex(covered))
+	{
+		entries.clear();
+		liveBytes = 0;
+		clock = 0;
+		covered = 0;
+	}
+
+	scan(covered);
+	return true;
+}
+
+/**
+ * Function that reads the index-file. The index is only accepted if it
+ * matches the data-file it was written for.
+ * @param	covered	Returns the size of the data-file the index describes.
+ * @return	True if the index could be read, false otherwise.
+ */
+bool PuMP_ThumbnailCache::readIndex(qint64 &covered)
+{
+	QFile index(dir.absoluteFilePath(THUMBNAIL_CACHE_INDEX));
+	if(!index.open(QIODevice::ReadOnly)) return false;
+
+	QDataStream stream(&index);
+	stream.setVersion(QDataStream::Qt_4_2);
+
+	quint32 magic, version, count;
+	qint64 dataSize;
+	stream >> magic >> version >> dataSize >> clock >> count;
+	if(stream.status() != QDataStream::Ok ||
+		magic != THUMBNAIL_CACHE_MAGIC ||
+		version != THUMBNAIL_CACHE_VERSION ||
+		dataSize > data.size())
+		return false;
+
+	quint32 i;
+	for(i = 0; i < count; i++)
+	{
+		QString path;
+		PuMP_ThumbnailCacheEntry entry;
+		stream >> path >> entry.offset >> entry.length >> entry.mtime
+			>> entry.size >> entry.imageSize >> entry.lastUsed;
+		if(stream.status() != QDataStream::Ok ||
+			entry.offset + entry.length > dataSize)
+			return false;
+
+		entries.insert(path, entry);
+		liveBytes += entry.length;
+	}
+
+	covered = dataSize;
+	return true;
+}
+
+/**
+ * Function that scans the data-file from the given offset on and adds all
+ * valid records to the index. The file is truncated at the first record
+ * that is damaged, which is what an interrupted append leaves behind.
+ * @param	from	The offset to start scanning at.
+ */
+void PuMP_ThumbnailCache::scan(qint64 from)
+{
+	qint64 pos = from;
+	while(pos + RECORD_HEADER <= data.size())
+	{
+		if(!data.seek(pos)) break;
+
+		QDataStream header(&data);
+		quint32 magic, length, crc;
+		header >> magic >> length >> crc;
+		if(magic != THUMBNAIL_CACHE_MAGIC || length > RECORD_MAX ||
+			pos + RECORD_HEADER + length > data.size())
+			break;
+
+		QByteArray payload = readRecord(pos, RECORD_HEADER + length);
+		if(payload.isNull()) break;
+
+		QDataStream stream(payload);
+		stream.setVersion(QDataStream::Qt_4_2);
+
+		QString path;
+		PuMP_ThumbnailCacheEntry entry;
+		stream >> path >> entry.mtime >> entry.size >> entry.imageSize;
+		if(stream.status() != QDataStream::Ok) break;
+
+		entry.offset = pos;
+		entry.length = RECORD_HEADER + length;
+		entry.lastUsed = ++clock;
+
+		QHash<QString, PuMP_ThumbnailCacheEntry>::iterator it;
+		it = entries.find(path);
+		if(it != entries.end()) liveBytes -= it.value().length;
+		entries.insert(path, entry);
+		liveBytes += entry.length;
+
+		pos += entry.length;
+	}
+
+	if(pos < data.size())
+	{
+		qDebug() << "thumbnail-cache truncated at" << pos;
+		data.resize(pos);
+	}
+}
+
+/**
+ * Function that reads and validates a record of the data-file.
+ * @param	offset	The offset of the record.
+ * @param	length	The length of the record including its header.
+ * @return	The payload of the record or a null byte-array if the record is
+ * 			damaged.
+ */
+QByteArray PuMP_ThumbnailCache::readRecord(qint64 offset, qint32 length)
+{
+	if(length < RECORD_HEADER || !data.seek(offset)) return QByteArray();
+
+	QByteArray record = data.read(length);
+	if(record.size() != length) return QByteArray();
+
+	QDataStream header(record);
+	quint32 magic, payloadLength, crc;
+	header >> magic >> payloadLength >> crc;
+	if(magic != THUMBNAIL_CACHE_MAGIC ||
+		payloadLength != (quint32)(length - RECORD_HEADER))
+		return QByteArray();
+
+	QByteArray payload = record.mid(RECORD_HEADER);
+	uLong check = crc32(0L, Z_NULL, 0);
+	check = crc32(
+		check,
+		(const Bytef *) payload.constData(),
+		payload.size());
+	if((quint32) check != crc) return QByteArray();
+
+	return payload;
+}
+
+/**
+ * Function that writes the index to a temporary file and moves it over the
+ * old one, so a crash never leaves a half written index behind.
+ * @return	True on success, false otherwise.
+ */
+bool PuMP_ThumbnailCache::writeIndex()
+{
+	QString indexPath = dir.absoluteFilePath(THUMBNAIL_CACHE_INDEX);
+	QFile index(indexPath + THUMBNAIL_CACHE_TMP);
+	if(!index.open(QIODevice::WriteOnly | QIODevice::Truncate)) return false;
+
+	QDataStream stream(&index);
+	stream.setVersion(QDataStream::Qt_4_2);
+	stream << (quint32) THUMBNAIL_CACHE_MAGIC
+		<< (quint32) THUMBNAIL_CACHE_VERSION
+		<< (qint64) data.size()
+		<< clock
+		<< (quint32) entries.size();
+
+	QHash<QString, PuMP_ThumbnailCacheEntry>::const_iterator it;
+	for(it = entries.constBegin(); it != entries.constEnd(); it++)
+	{
+		const PuMP_ThumbnailCacheEntry &entry = it.value();
+		stream << it.key() << entry.offset << entry.length << entry.mtime
+			<< entry.size << entry.imageSize << entry.lastUsed;
+	}
+
+	index.flush();
+	bool ok = (stream.status() == QDataStream::Ok &&
+		index.error() == QFile::NoError);
+	index.close();
+
+	if(!ok)
+	{
+		index.remove();
+		return false;
+	}
+
+	QFile::remove(indexPath);
+	return QFile::rename(index.fileName(), indexPath);
+}
+
+/**
+ * Function that looks up the thumbnails of the given file. An entry only
+ * matches if path, modification-time and size of the file are unchanged.
+ * @param	info		The file to look up.
+ * @param	levels		Returns the cached thumbnails, smallest first.
+ * @param	imageSize	Returns the dimensions of the original image.
+ * @return	True on a cache-hit, false otherwise.
+ */
+bool PuMP_ThumbnailCache::lookup(
+	const QFileInfo &info,
+	QList<QImage> &levels,
+	QSize &imageSize)
+{
+	levels.clear();
+
+	QMutexLocker locker(&mutex);
+	if(!valid) return false;
+
+	QString path = info.absoluteFilePath();
+	QHash<QString, PuMP_ThumbnailCacheEntry>::iterator it;
+	it = entries.find(path);
+	if(it == entries.end()) return false;
+
+	PuMP_ThumbnailCacheEntry &entry = it.value();
+	if(entry.mtime != info.lastModified().toTime_t() ||
+		entry.size != info.size())
+	{
+		liveBytes -= entry.length;
+		entries.erase(it);
+		return false;
+	}
+
+	QByteArray payload = readRecord(entry.offset, entry.length);
+	QDataStream stream(payload);
+	stream.setVersion(QDataStream::Qt_4_2);
+
+	QString recordPath;
+	uint mtime;
+	qint64 size;
+	QSize recordImageSize;
+	qint32 count;
+	stream >> recordPath >> mtime >> size >> recordImageSize >> count;
+	bool ok = !payload.isNull() && stream.status() == QDataStream::Ok &&
+		recordPath == path && count > 0 && count <= THUMBNAIL_CACHE_LEVELS;
+
+	qint32 i;
+	for(i = 0; ok && i < count; i++)
+	{
+		qint32 width, height;
+		QByteArray pixels;
+		stream >> width >> height >> pixels;
+		pixels = qUncompress(pixels);
+		if(stream.status() != QDataStream::Ok || width <= 0 || height <= 0 ||
+			pixels.size() != width * height * 4)
+		{
+			ok = false;
+			break;
+		}
+
+		QImage image(width, height, QImage::Format_ARGB32);
+		int y;
+		for(y = 0; y < height; y++)
+			memcpy(
+				image.scanLine(y),
+				pixels.constData() + y * width * 4,
+				width * 4);
+		levels.append(image);
+	}
+
+	if(!ok)
+	{
+		levels.clear();
+		liveBytes -= entry.length;
+		entries.erase(it);
+		return false;
+	}
+
+	imageSize = entry.imageSize;
+	entry.lastUsed = ++clock;
+	return true;
+}
+
+/**
+ * Function that appends the thumbnails of the given file to the cache. An
+ * outdated entry for the same file is replaced.
+ * @param	info		The file the thumbnails were made from.
+ * @param	levels		The thumbnails in different sizes, smallest first.
+ * @param	imageSize	The dimensions of the original image.
+ */
+void PuMP_ThumbnailCache::insert(
+	const QFileInfo &info,
+	const QList<QImage> &levels,
+	const QSize &imageSize)
+{
+	if(levels.isEmpty() || levels.size() > THUMBNAIL_CACHE_LEVELS) return;
+
+	QByteArray payload;
+	QDataStream stream(&payload, QIODevice::WriteOnly);
+	stream.setVersion(QDataStream::Qt_4_2);
+	stream << info.absoluteFilePath()
+		<< (uint) info.lastModified().toTime_t()
+		<< (qint64) info.size()
+		<< imageSize
+		<< (qint32) levels.size();
+
+	int i;
+	for(i = 0; i < levels.size(); i++)
+	{
+		if(levels.at(i).isNull()) return;
+
+		QImage argb = levels.at(i).convertToFormat(QImage::Format_ARGB32);
+		QByteArray pixels;
+		pixels.reserve(argb.width() * argb.height() * 4);
+
+		int y;
+		for(y = 0; y < argb.height(); y++)
+			pixels.append(QByteArray::fromRawData(
+				(const char *) argb.scanLine(y),
+				argb.width() * 4));
+
+		stream << (qint32) argb.width()
+			<< (qint32) argb.height()
+			<< qCompress(pixels, 1);
+	}
+
+	uLong crc = crc32(0L, Z_NULL, 0);
+	crc = crc32(crc, (const Bytef *) payload.constData(), payload.size());
+
+	QByteArray record;
+	QDataStream header(&record, QIODevice::WriteOnly);
+	header << (quint32) THUMBNAIL_CACHE_MAGIC
+		<< (quint32) payload.size()
+		<< (quint32) crc;
+	record.append(payload);
+	if(record.size() > RECORD_MAX) return;
+
+	QMutexLocker locker(&mutex);
+	if(!valid) return;
+
+	qint64 offset = data.size();
+	if(!data.seek(offset) || data.write(record) != record.size() ||
+		!data.flush())
+	{
+		data.resize(offset);
+		return;
+	}
+
+	PuMP_ThumbnailCacheEntry entry;
+	entry.offset = offset;
+	entry.length = record.size();
+	entry.mtime = info.lastModified().toTime_t();
+	entry.size = info.size();
+	entry.imageSize = imageSize;
+	entry.lastUsed = ++clock;
+
+	QString path = info.absoluteFilePath();
+	QHash<QString, PuMP_ThumbnailCacheEntry>::iterator it;
+	it = entries.find(path);
+	if(it != entries.end()) liveBytes -= it.value().length;
+	entries.insert(path, entry);
+	liveBytes += entry.length;
+
+	// the records are copied without holding the lock, lookups and inserts
+	// of the other threads go on meanwhile
+	bool wasteful = evictLocked();
+	locker.unlock();
+	if(wasteful) compact();
+}
+
+/**
+ * Function that drops the least recently used entries once the cache grew
+ * beyond its limit.
+ * @return	True if so much of the data-file is unused that it should be
+ * 			compacted, false otherwise.
+ */
+bool PuMP_ThumbnailCache::evictLocked()
+{
+	if(liveBytes > maxBytes)
+	{
+		QList<QPair<quint32, QString> > order;
+		QHash<QString, PuMP_ThumbnailCacheEntry>::const_iterator it;
+		for(it = entries.constBegin(); it != entries.constEnd(); it++)
+			order.append(qMakePair(it.value().lastUsed, it.key()));
+		qSort(order);
+
+		int i = 0;
+		while(liveBytes > maxBytes * 3 / 4 && i < order.size())
+		{
+			liveBytes -= entries.value(order.at(i).second).length;
+			entries.remove(order.at(i).second);
+			i++;
+		}
+	}
+
+	return data.size() - liveBytes > maxBytes / 2;
+}
+
+/**
+ * Function that rewrites the data-file with all entries that are still in
+ * use. The records are copied into a new file without holding the lock,
+ * only the records appended meanwhile are copied with it held, before the
+ * new file replaces the old one. Entries dropped meanwhile are left in the
+ * new file unreferenced. Only one compaction runs at a time.
+ */
+void PuMP_ThumbnailCache::compact()
+{
+	mutex.lock();
+	if(!valid || compacting)
+	{
+		mutex.unlock();
+		return;
+	}
+	compacting = true;
+
+	// copy the records in file-order to keep reading sequential
+	QHash<QString, PuMP_ThumbnailCacheEntry> snapshot = entries;
+	QList<QPair<qint64, qint32> > order;
+	QHash<QString, PuMP_ThumbnailCacheEntry>::const_iterator it;
+	for(it = snapshot.constBegin(); it != snapshot.constEnd(); it++)
+		order.append(qMakePair(it.value().offset, it.value().length));
+	qint64 copied = data.size();
+	QString dataPath = data.fileName();
+	mutex.unlock();
+
+	QFile source(dataPath);
+	QFile out(dataPath + THUMBNAIL_CACHE_TMP);
+	bool ok = source.open(QIODevice::ReadOnly) &&
+		out.open(QIODevice::WriteOnly | QIODevice::Truncate);
+	qSort(order);
+
+	// the records are found by their old offset, which is unique and
+	// doesn't change but by a compaction
+	QHash<qint64, qint64> moved;
+	qint64 pos = 0;
+	int i;
+	for(i = 0; i < order.size() && ok; i++)
+	{
+		if(closing.isCancelled() || !source.seek(order.at(i).first))
+		{
+			ok = false;
+			break;
+		}
+
+		QByteArray record = source.read(order.at(i).second);
+		if(record.size() != order.at(i).second ||
+			out.write(record) != record.size())
+			ok = false;
+
+		moved.insert(order.at(i).first, pos);
+		pos += record.size();
+	}
+	source.close();
+
+	QMutexLocker locker(&mutex);
+	compacting = false;
+
+	QList<QPair<qint64, qint32> > appended;
+	QHash<QString, PuMP_ThumbnailCacheEntry>::iterator mit;
+	for(mit = entries.begin(); mit != entries.end(); mit++)
+		if(mit.value().offset >= copied) appended.append(
+			qMakePair(mit.value().offset, mit.value().length));
+	qSort(appended);
+
+	for(i = 0; i < appended.size() && ok && valid; i++)
+	{
+		if(!data.seek(appended.at(i).first))
+		{
+			ok = false;
+			break;
+		}
+
+		QByteArray record = data.read(appended.at(i).second);
+		if(record.size() != appended.at(i).second ||
+			out.write(record) != record.size())
+			ok = false;
+
+		moved.insert(appended.at(i).first, pos);
+		pos += record.size();
+	}
+
+	ok = ok && valid && out.flush();
+	out.close();
+	if(!ok)
+	{
+		out.remove();
+		return;
+	}
+
+	data.close();
+	QFile::remove(dir.absoluteFilePath(THUMBNAIL_CACHE_INDEX));
+	QFile::remove(dataPath);
+	QFile::rename(out.fileName(), dataPath);
+
+	data.setFileName(dataPath);
+	if(!data.open(QIODevice::ReadWrite))
+	{
+		valid = false;
+		entries.clear();
+		liveBytes = 0;
+		return;
+	}
+
+	liveBytes = 0;
+	mit = entries.begin();
+	while(mit != entries.end())
+	{
+		if(!moved.contains(mit.value().offset))
+		{
+			mit = entries.erase(mit);
+			continue;
+		}
+
+		mit.value().offset = moved.value(mit.value().offset);
+		liveBytes += mit.value().length;
+		mit++;
+	}
+
+	writeIndex();
+}
+
+/**
+ * Function that removes all entries whose original file vanished or changed
+ * and compacts the data-file afterwards. The files are checked without
+ * holding the lock, it's run by a PuMP_ThumbnailCollector in the background.
+ */
+void PuMP_ThumbnailCache::collectGarbage()
+{
+	mutex.lock();
+	bool ok = valid;
+	QHash<QString, PuMP_ThumbnailCacheEntry> snapshot = entries;
+	mutex.unlock();
+	if(!ok) return;
+
+	QStringList stale;
+	QHash<QString, PuMP_ThumbnailCacheEntry>::const_iterator it;
+	for(it = snapshot.constBegin(); it != snapshot.constEnd(); it++)
+	{
+		if(closing.isCancelled()) return;
+
+		QFileInfo info(it.key());
+		if(!info.exists() ||
+			it.value().mtime != info.lastModified().toTime_t() ||
+			it.value().size != info.size())
+			stale.append(it.key());
+	}
+
+	// entries replaced meanwhile are kept
+	mutex.lock();
+	int i;
+	for(i = 0; i < stale.size(); i++)
+	{
+		QHash<QString, PuMP_ThumbnailCacheEntry>::iterator entry;
+		entry = entries.find(stale.at(i));
+		if(entry == entries.end() ||
+			entry.value().offset != snapshot.value(stale.at(i)).offset)
+			continue;
+
+		liveBytes -= entry.value().length;
+		entries.erase(entry);
+	}
+	lastGC = QDateTime::currentDateTime().toTime_t();
+	mutex.unlock();
+
+	compact();
+}
+
+/*****************************************************************************/
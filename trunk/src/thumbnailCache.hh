@@ -0,0 +1,132 @@
+/*
+ * Copyright 2007 Christoph Werle, Tobias Schlager
+ * 
+ * This file is part of "PuMP - Publish My Pictures".
+ *
+ * "Publish My Pictures" is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * "Publish My Pictures" is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with "Publish My Pictures"; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ */
+
+#ifndef THUMBNAILCACHE_HH_
+#define THUMBNAILCACHE_HH_
+
+#include <QByteArray>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QImage>
+#include <QList>
+#include <QMutex>
+#include <QSize>
+#include <QString>
+#include <QThread>
+
+#include "cancelToken.hh"
+#include "settings.hh"
+
+/******************************************************************************/
+
+#define THUMBNAIL_CACHE_DIR			".pump"
+#define THUMBNAIL_CACHE_DATA		"thumbnails.dat"
+#define THUMBNAIL_CACHE_INDEX		"thumbnails.idx"
+#define THUMBNAIL_CACHE_TMP			".tmp"
+#define THUMBNAIL_CACHE_MAGIC		0x50754d50
+#define THUMBNAIL_CACHE_VERSION		2
+#define THUMBNAIL_CACHE_LEVELS		8
+#define THUMBNAIL_CACHE_MAXSIZE		256
+#define THUMBNAIL_CACHE_GC_DAYS		7
+
+#define PUMP_THUMBNAILCACHE_MAXSIZE	"PuMP_ThumbnailCache::maxSize"
+#define PUMP_THUMBNAILCACHE_LASTGC	"PuMP_ThumbnailCache::lastGC"
+
+/******************************************************************************/
+
+class PuMP_ThumbnailCacheEntry
+{
+	public:
+		qint64 offset;
+		qint32 length;
+		uint mtime;
+		qint64 size;
+		QSize imageSize;
+		quint32 lastUsed;
+
+		PuMP_ThumbnailCacheEntry();
+};
+
+/******************************************************************************/
+
+class PuMP_ThumbnailCache;
+
+class PuMP_ThumbnailCollector : public QThread
+{
+	protected:
+		PuMP_ThumbnailCache *cache;
+
+		void run();
+
+	public:
+		PuMP_ThumbnailCollector(PuMP_ThumbnailCache *cache);
+};
+
+/******************************************************************************/
+
+class PuMP_ThumbnailCache : public PuMP_SettingsInterface
+{
+	protected:
+		bool compacting;
+		bool valid;
+		quint32 clock;
+		qint64 liveBytes;
+		qint64 maxBytes;
+		uint lastGC;
+
+		QDir dir;
+		QFile data;
+		QHash<QString, PuMP_ThumbnailCacheEntry> entries;
+		QMutex mutex;
+		PuMP_CancelToken closing;
+		PuMP_ThumbnailCollector *collector;
+
+		bool evictLocked();
+		bool open();
+		bool readIndex(qint64 &covered);
+		QByteArray readRecord(qint64 offset, qint32 length);
+		void scan(qint64 from);
+		bool writeIndex();
+
+	public:
+		PuMP_ThumbnailCache();
+		~PuMP_ThumbnailCache();
+
+		void collectGarbage();
+		void compact();
+		void insert(
+			const QFileInfo &info,
+			const QList<QImage> &levels,
+			const QSize &imageSize);
+		bool lookup(
+			const QFileInfo &info,
+			QList<QImage> &levels,
+			QSize &imageSize);
+
+		void loadSettings();
+		void storeSettings();
+};
+
+/******************************************************************************/
+
+#endif /*THUMBNAILCACHE_HH_*/